@@ -0,0 +1,171 @@
+/*
+ * backend.c - The registry of malloc packages
+ *
+ * To add a package, write it against mm.h, build it with its own RENAME
+ * prefix in the Makefile, declare its functions below and list it in
+ * backends[].
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.h"
+#include "config.h"
+
+/* The implicit free list package in mm_implicit_list.c */
+extern int implicit_init(void);
+extern void *implicit_malloc(size_t size);
+extern void implicit_free(void *ptr);
+extern void *implicit_realloc(void *ptr, size_t size);
+extern int implicit_check(void);
+
+/* The mm.h functions of a package built with the RENAME prefix "prefix" */
+#define DECLARE_MM(prefix) \
+    extern int prefix##_init(void); \
+    extern void *prefix##_malloc(size_t size); \
+    extern void prefix##_free(void *ptr); \
+    extern void *prefix##_realloc(void *ptr, size_t size); \
+    extern int prefix##_check(void); \
+    extern void prefix##_stats(mm_stats_t *stats); \
+    extern int prefix##_init_hint(size_t heap_size)
+
+/* mm.c built with its other free list and growth policies */
+DECLARE_MM(mm_addr);
+DECLARE_MM(mm_next);
+DECLARE_MM(mm_addr_next);
+DECLARE_MM(mm_fixed);
+
+/* Instances of mm_core.h */
+DECLARE_MM(core_first);
+DECLARE_MM(core_best);
+DECLARE_MM(core_seg);
+DECLARE_MM(core_seg_lazy);
+DECLARE_MM(core_seg_w8);
+DECLARE_MM(core_classes);
+DECLARE_MM(core_classes_tuned);
+
+/* The C library's malloc needs no initialization */
+static int libc_init(void)
+{
+    return 0;
+}
+
+/* The null package: the least a package can do without failing */
+static char null_block[ALIGNMENT];
+
+static int null_init(void)
+{
+    return 0;
+}
+
+static void *null_malloc(size_t size)
+{
+    return null_block;
+}
+
+static void null_free(void *ptr)
+{
+}
+
+static void *null_realloc(void *ptr, size_t size)
+{
+    return null_block;
+}
+
+static backend_t mm_backend = {
+    "mm", "explicit free list, LIFO, first fit (mm.c)", 1, 0,
+    mm_init, mm_malloc, mm_free, mm_realloc, mm_check, mm_stats,
+    mm_init_hint
+};
+
+static backend_t mm_addr_backend = {
+    "mm-addr", "explicit free list, address ordered, first fit (mm.c)", 1, 0,
+    mm_addr_init, mm_addr_malloc, mm_addr_free, mm_addr_realloc,
+    mm_addr_check, mm_addr_stats, mm_addr_init_hint
+};
+
+static backend_t mm_next_backend = {
+    "mm-next", "explicit free list, LIFO, next fit (mm.c)", 1, 0,
+    mm_next_init, mm_next_malloc, mm_next_free, mm_next_realloc,
+    mm_next_check, mm_next_stats, mm_next_init_hint
+};
+
+static backend_t mm_addr_next_backend = {
+    "mm-addr-next", "explicit free list, address ordered, next fit (mm.c)", 1, 0,
+    mm_addr_next_init, mm_addr_next_malloc, mm_addr_next_free,
+    mm_addr_next_realloc, mm_addr_next_check, mm_addr_next_stats,
+    mm_addr_next_init_hint
+};
+
+static backend_t mm_fixed_backend = {
+    "mm-fixed", "explicit free list, LIFO, first fit, fixed growth (mm.c)", 1, 0,
+    mm_fixed_init, mm_fixed_malloc, mm_fixed_free, mm_fixed_realloc,
+    mm_fixed_check, mm_fixed_stats, mm_fixed_init_hint
+};
+
+#define CORE_BACKEND(prefix, name, desc) { \
+    name, desc, 1, 0, prefix##_init, prefix##_malloc, prefix##_free, \
+    prefix##_realloc, prefix##_check, NULL \
+}
+
+static backend_t core_backends[] = {
+    CORE_BACKEND(core_first, "core-first", "mm_core.h, first fit"),
+    CORE_BACKEND(core_best, "core-best", "mm_core.h, best fit"),
+    CORE_BACKEND(core_seg, "core-seg",
+		 "mm_core.h, segregated fit, footers only in free blocks"),
+    CORE_BACKEND(core_seg_lazy, "core-seg-lazy",
+		 "mm_core.h, segregated fit, deferred coalescing"),
+    CORE_BACKEND(core_seg_w8, "core-seg-w8",
+		 "mm_core.h, segregated fit, 8-byte headers"),
+    CORE_BACKEND(core_classes, "core-classes",
+		 "mm_core.h, blocks rounded up to size classes (mm_classes.h)"),
+    CORE_BACKEND(core_classes_tuned, "core-classes-tuned",
+		 "mm_core.h, blocks rounded up to fitted size classes "
+		 "(mm_classes_tuned.h)"),
+};
+
+static backend_t implicit_backend = {
+    "implicit", "implicit free list, first fit (mm_implicit_list.c)", 1, 0,
+    implicit_init, implicit_malloc, implicit_free, implicit_realloc,
+    implicit_check, NULL
+};
+
+static backend_t libc_backend = {
+    "libc", "the C library's malloc", 0, 1,
+    libc_init, malloc, free, realloc, NULL, NULL
+};
+
+backend_t null_backend = {
+    "null", "no-op, for timing mdriver itself", 0, 1,
+    null_init, null_malloc, null_free, null_realloc, NULL, NULL
+};
+
+backend_t *backends[] = {
+    &mm_backend,
+    &mm_addr_backend,
+    &mm_next_backend,
+    &mm_addr_next_backend,
+    &mm_fixed_backend,
+    &core_backends[0],
+    &core_backends[1],
+    &core_backends[2],
+    &core_backends[3],
+    &core_backends[4],
+    &core_backends[5],
+    &core_backends[6],
+    &implicit_backend,
+    &libc_backend,
+    NULL
+};
+
+/*
+ * find_backend - look up a backend by name
+ */
+backend_t *find_backend(char *name)
+{
+    int i;
+
+    for (i = 0; backends[i] != NULL; i++)
+	if (!strcmp(backends[i]->name, name))
+	    return backends[i];
+    return NULL;
+}
@@ -0,0 +1,45 @@
+/*
+ * backend.h - The malloc packages that mdriver can evaluate
+ *
+ * mdriver reaches every malloc package through a backend_t, so that one
+ * binary can run several of them side by side (mdriver -A). The package
+ * in mm.c is "mm". Other packages written against mm.h are compiled with
+ * their mm_* names given a prefix instead (see RENAME in the Makefile),
+ * so that they can be linked in next to it.
+ */
+#ifndef __BACKEND_H_
+#define __BACKEND_H_
+
+#include <stddef.h>
+#include "mm.h"
+
+typedef struct {
+    char *name;              /* what mdriver -A calls it */
+    char *description;       /* one line for mdriver -h */
+    int uses_memlib;         /* set if the heap comes from mem_sbrk, in
+				which case mdriver measures utilization and
+				checks that payloads lie in the heap */
+    int thread_safe;         /* set if it may be called from several
+				threads at once; if not, a multithreaded
+				replay takes a lock around every call */
+    int (*init)(void);       /* reset the package for the next run */
+    void *(*malloc)(size_t size);
+    void (*free)(void *ptr);
+    void *(*realloc)(void *ptr, size_t size);
+    int (*check)(void);               /* heap checker, or NULL */
+    void (*stats)(mm_stats_t *stats); /* mm_stats, or NULL */
+    int (*init_hint)(size_t heap_size); /* mm_init_hint, or NULL */
+} backend_t;
+
+/* All the backends, terminated by NULL. The first is the default. */
+extern backend_t *backends[];
+
+/* Does nothing and hands out one static block for every request, so
+   timing it measures mdriver's own loop (mdriver --calibrate). It isn't
+   in backends[], since its blocks overlap. */
+extern backend_t null_backend;
+
+/* Look up a backend by name, NULL if there is none */
+backend_t *find_backend(char *name);
+
+#endif /* __BACKEND_H_ */
@@ -0,0 +1,187 @@
+/*
+ * classbench.c - Time the size-to-class lookup of mm_classes.h
+ *
+ * Runs each of the following over the same array of random request
+ * sizes, and reports the time per size:
+ *
+ *   ALIGN        mm.c's ALIGN macro (a compare and a divide)
+ *   loop         the class by a search over mm_class_limit
+ *   table        the class by mm_size_class
+ *   ALIGN+table  both, the work of a segregated fit malloc
+ *
+ * Most sizes are small, as in real programs: 80% are up to 256 bytes
+ * and the rest up to 16 KB, each uniform. The best of several rounds
+ * is reported.
+ *
+ * Usage: classbench [-n sizes] [-r rounds] [-s seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "mm_classes.h"
+
+/* Defaults */
+#define SIZES   (1 << 16)
+#define ROUNDS  200
+
+/* mm.c's ALIGN, with its 32-bit DSIZE */
+#define DSIZE 8
+#define ALIGN(size) (size <= DSIZE ? 2*DSIZE : DSIZE * ((size + (DSIZE) + (DSIZE-1)) / DSIZE))
+
+static size_t *sizes;
+static int num_sizes = SIZES;
+static volatile size_t sink;      /* keeps the results alive */
+
+static unsigned long long rng_state;
+
+/* Function prototypes */
+static void usage(void);
+
+static unsigned long long rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * The methods; each returns a sum of its results
+ */
+static size_t run_align(void)
+{
+    size_t sum = 0;
+    int i;
+
+    for (i = 0; i < num_sizes; i++)
+        sum += ALIGN(sizes[i]);
+    return sum;
+}
+
+static size_t run_loop(void)
+{
+    size_t sum = 0;
+    int i, c;
+
+    for (i = 0; i < num_sizes; i++) {
+        for (c = 0; c < MM_CLASSES - 1; c++)
+            if (sizes[i] <= mm_class_limit[c])
+                break;
+        sum += c;
+    }
+    return sum;
+}
+
+static size_t run_table(void)
+{
+    size_t sum = 0;
+    int i;
+
+    for (i = 0; i < num_sizes; i++)
+        sum += mm_size_class(sizes[i]);
+    return sum;
+}
+
+static size_t run_both(void)
+{
+    size_t sum = 0;
+    int i;
+
+    for (i = 0; i < num_sizes; i++)
+        sum += mm_size_class(ALIGN(sizes[i]));
+    return sum;
+}
+
+/*
+ * bench - the best time per size of rounds runs of f, in nanoseconds
+ */
+static double bench(size_t (*f)(void), int rounds)
+{
+    double best = 1e30, start, secs;
+    int r;
+
+    for (r = 0; r < rounds; r++) {
+        start = now();
+        sink = f();
+        secs = now() - start;
+        if (secs < best)
+            best = secs;
+    }
+    return best / num_sizes * 1e9;
+}
+
+static void report(char *method, double ns, double align_ns)
+{
+    printf("%-12s%10.2f%10.2f\n", method, ns, ns / align_ns);
+}
+
+int main(int argc, char **argv)
+{
+    int c, i, rounds = ROUNDS;
+    double align_ns;
+
+    rng_state = 1;
+    while ((c = getopt(argc, argv, "n:r:s:h")) != EOF) {
+        switch (c) {
+        case 'n': /* Number of sizes */
+            num_sizes = atoi(optarg);
+            break;
+        case 'r': /* Rounds per method */
+            rounds = atoi(optarg);
+            break;
+        case 's': /* Random seed */
+            rng_state = strtoull(optarg, NULL, 0) | 1;
+            break;
+        case 'h':
+            usage();
+            exit(0);
+        default:
+            usage();
+            exit(1);
+        }
+    }
+    if (num_sizes < 1 || rounds < 1) {
+        usage();
+        exit(1);
+    }
+
+    if ((sizes = malloc(num_sizes * sizeof(size_t))) == NULL) {
+        fprintf(stderr, "classbench: out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < num_sizes; i++)
+        sizes[i] = 1 + rng_next() % (rng_next() % 5 ? 256 : 16384);
+
+    printf("%d classes, %d sizes, best of %d rounds\n",
+           MM_CLASSES, num_sizes, rounds);
+    printf("%-12s%10s%10s\n", "method", "ns/size", "vs ALIGN");
+    align_ns = bench(run_align, rounds);
+    report("ALIGN", align_ns, align_ns);
+    report("loop", bench(run_loop, rounds), align_ns);
+    report("table", bench(run_table, rounds), align_ns);
+    report("ALIGN+table", bench(run_both, rounds), align_ns);
+    exit(0);
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: classbench [-h] [-n <sizes>] [-r <rounds>] [-s <seed>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h          Print this message.\n");
+    fprintf(stderr, "\t-n <n>      Number of random sizes (default %d).\n", SIZES);
+    fprintf(stderr, "\t-r <n>      Rounds per method; the best is reported (default %d).\n", ROUNDS);
+    fprintf(stderr, "\t-s <seed>   Random seed (default 1).\n");
+}
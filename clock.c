@@ -10,6 +10,10 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/times.h>
+#include <time.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
 #include "clock.h"
 
 
@@ -21,53 +25,37 @@
  * You can verify this for yourself using gcc -v.
  *******************************************************/
 
-#if defined(__i386__)  
+#if defined(__i386__) || defined(__x86_64__)
 /*******************************************************
- * Pentium versions of start_counter() and get_counter()
+ * x86 versions of start_counter() and get_counter()
  *******************************************************/
 
 
 /* $begin x86cyclecounter */
 /* Initialize the cycle counter */
-static unsigned cyc_hi = 0;
-static unsigned cyc_lo = 0;
+static unsigned long long cyc_start = 0;
 
 
-/* Set *hi and *lo to the high and low order bits  of the cycle counter.  
+/* Return the full 64-bit value of the time stamp counter.
    Implementation requires assembly code to use the rdtsc instruction. */
-void access_counter(unsigned *hi, unsigned *lo)
+static unsigned long long access_counter(void)
 {
-    asm("rdtsc; movl %%edx,%0; movl %%eax,%1"   /* Read cycle counter */
-	: "=r" (*hi), "=r" (*lo)                /* and move results to */
-	: /* No input */                        /* the two outputs */
-	: "%edx", "%eax");
+    unsigned hi, lo;
+
+    asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((unsigned long long) hi << 32) | lo;
 }
 
 /* Record the current value of the cycle counter. */
 void start_counter()
 {
-    access_counter(&cyc_hi, &cyc_lo);
+    cyc_start = access_counter();
 }
 
 /* Return the number of cycles since the last call to start_counter. */
 double get_counter()
 {
-    unsigned ncyc_hi, ncyc_lo;
-    unsigned hi, lo, borrow;
-    double result;
-
-    /* Get cycle counter */
-    access_counter(&ncyc_hi, &ncyc_lo);
-
-    /* Do double precision subtraction */
-    lo = ncyc_lo - cyc_lo;
-    borrow = lo > ncyc_lo;
-    hi = ncyc_hi - cyc_hi - borrow;
-    result = (double) hi * (1 << 30) * 4 + lo;
-    if (result < 0) {
-	fprintf(stderr, "Error: counter returns neg value: %.0f\n", result);
-    }
-    return result;
+    return (double) (access_counter() - cyc_start);
 }
 /* $end x86cyclecounter */
 
@@ -277,3 +265,132 @@ double get_comp_counter()
     return ctime;
 }
 
+
+/*****************************************************************
+ * Counters for the "mono" and "tsc" timing methods in fsecs.c.
+ *
+ * The mono counter reads CLOCK_MONOTONIC_RAW, which is immune to NTP
+ * slewing and has nanosecond resolution on any modern Linux box. The
+ * tsc counter reads the time stamp counter with rdtscp, which waits
+ * for all earlier instructions to retire, so the timed function cannot
+ * leak past the end of the measurement. It is only a usable clock when
+ * the TSC is invariant, i.e., ticks at a constant rate across P- and
+ * C-state changes.
+ *****************************************************************/
+
+/* Return CLOCK_MONOTONIC_RAW in nanoseconds */
+static double mono_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double mono_start = 0.0;
+
+/* Record the current value of the monotonic clock */
+void start_mono_counter()
+{
+    mono_start = mono_ns();
+}
+
+/* Return the number of nanoseconds since the last call to start_mono_counter */
+double get_mono_counter()
+{
+    return mono_ns() - mono_start;
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+
+static unsigned long long tsc_start = 0;
+
+/* Return the time stamp counter once all prior instructions have retired */
+static unsigned long long access_tscp(void)
+{
+    unsigned hi, lo, aux;
+
+    asm volatile("rdtscp" : "=a" (lo), "=d" (hi), "=c" (aux));
+    return ((unsigned long long) hi << 32) | lo;
+}
+
+/* Does the processor have rdtscp and an invariant TSC? */
+int tsc_invariant()
+{
+    unsigned eax, ebx, ecx, edx;
+
+    if (__get_cpuid_max(0x80000000, NULL) < 0x80000007)
+	return 0;
+    __cpuid(0x80000001, eax, ebx, ecx, edx);
+    if (!(edx & (1 << 27)))        /* RDTSCP */
+	return 0;
+    __cpuid(0x80000007, eax, ebx, ecx, edx);
+    return (edx & (1 << 8)) != 0;  /* Invariant TSC */
+}
+
+/* 
+ * tsc_mhz - Return the TSC frequency. Use the TSC/crystal ratio from
+ * cpuid leaf 0x15 when the processor reports it, and otherwise
+ * calibrate against CLOCK_MONOTONIC_RAW with a short busy wait rather
+ * than with sleep(), which can take far longer than requested.
+ */
+double tsc_mhz(int verbose)
+{
+    unsigned eax, ebx, ecx, edx;
+    unsigned long long c0, c1;
+    double t0, t1, rate = 0.0;
+
+    if (__get_cpuid_max(0, NULL) >= 0x15) {
+	__cpuid(0x15, eax, ebx, ecx, edx);
+	if (eax && ebx && ecx)
+	    rate = (double) ecx * ebx / eax / 1e6;
+    }
+    if (rate == 0.0) {
+	t0 = mono_ns();
+	c0 = access_tscp();
+	do {
+	    t1 = mono_ns();
+	} while (t1 - t0 < 50e6);
+	c1 = access_tscp();
+	rate = (c1 - c0) / ((t1 - t0) / 1e3);
+    }
+    if (verbose)
+	printf("Invariant TSC rate ~= %.1f MHz\n", rate);
+    return rate;
+}
+
+/* Record the current value of the TSC */
+void start_tsc_counter()
+{
+    tsc_start = access_tscp();
+}
+
+/* Return the number of TSC ticks since the last call to start_tsc_counter */
+double get_tsc_counter()
+{
+    return (double) (access_tscp() - tsc_start);
+}
+
+#else
+
+int tsc_invariant()
+{
+    return 0;
+}
+
+double tsc_mhz(int verbose)
+{
+    printf("ERROR: There is no time stamp counter on this platform.\n");
+    exit(1);
+}
+
+void start_tsc_counter()
+{
+    tsc_mhz(0);
+}
+
+double get_tsc_counter()
+{
+    return tsc_mhz(0);
+}
+#endif
@@ -20,3 +20,19 @@ double mhz_full(int verbose, int sleeptime);
 void start_comp_counter();
 
 double get_comp_counter();
+
+/** Counters used by the "mono" and "tsc" timing methods */
+
+/* Start/read CLOCK_MONOTONIC_RAW, in nanoseconds */
+void start_mono_counter();
+double get_mono_counter();
+
+/* Does this processor have rdtscp and an invariant TSC? */
+int tsc_invariant();
+
+/* Determine the TSC frequency without sleeping */
+double tsc_mhz(int verbose);
+
+/* Start/read the TSC using the serializing rdtscp instruction */
+void start_tsc_counter();
+double get_tsc_counter();
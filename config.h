@@ -62,8 +62,25 @@
  */
 #define MAX_HEAP (20*(1<<20))  /* 100 MB */
 
+/*
+ * Cache line size in bytes. mdriver --touch touches payloads one line
+ * at a time.
+ */
+#define CACHE_LINE 64
+
+/*
+ * Address space reserved for the heap when memlib is built with
+ * MEMLIB_MMAP (as in the LD_PRELOAD shim), and the granularity in which
+ * mem_sbrk makes the reservation usable
+ */
+#define MMAP_HEAP (1u<<30)     /* 1 GB */
+#define MMAP_COMMIT (1<<16)    /* 64 KB */
+
 /*****************************************************************************
- * Set exactly one of these USE_xxx constants to "1" to select a timing method
+ * Set exactly one of these USE_xxx constants to "1" to select the default
+ * timing method. The driver's -T flag overrides it at runtime, and also
+ * offers "mono" (CLOCK_MONOTONIC_RAW) and "tsc" (rdtscp on an invariant
+ * TSC), which use the K-best scheme and report confidence intervals.
  *****************************************************************************/
 #define USE_FCYC   0   /* cycle counter w/K-best scheme (x86 & Alpha only) */
 #define USE_ITIMER 0   /* interval timer (any Unix box) */
@@ -10,12 +10,14 @@
 #include <stdlib.h>
 #include <sys/times.h>
 #include <stdio.h>
+#include <math.h>
 
 #include "fcyc.h"
 #include "clock.h"
 
 /* Default values */
 #define K 3                  /* Value of K in K-best scheme */
+#define MINSAMPLES 0         /* Always take at least MINSAMPLES */
 #define MAXSAMPLES 20        /* Give up after MAXSAMPLES */
 #define EPSILON 0.01         /* K samples should be EPSILON of each other*/
 #define COMPENSATE 0         /* 1-> try to compensate for clock ticks */
@@ -24,6 +26,7 @@
 #define CACHE_BLOCK 32       /* Cache block size in bytes */
 
 static int kbest = K;
+static int minsamples = MINSAMPLES;
 static int maxsamples = MAXSAMPLES;
 static double epsilon = EPSILON;
 static int compensate = COMPENSATE;
@@ -33,16 +36,19 @@ static int cache_block = CACHE_BLOCK;
 
 static int *cache_buf = NULL;
 
+/* The counter used to time f; the cycle counter unless overridden */
+static counter_start_funct counter_start = start_counter;
+static counter_get_funct counter_get = get_counter;
+
 static double *values = NULL;
 static int samplecount = 0;
 
+/* Every sample of the last fcyc call, for fcyc_stats */
+static double *samples = NULL;
+static fcyc_stats_t last_stats;
+
 /* for debugging only */
 #define KEEP_VALS 0
-#define KEEP_SAMPLES 0
-
-#if KEEP_SAMPLES
-static double *samples = NULL;
-#endif
 
 /* 
  * init_sampler - Start new sampling process 
@@ -52,12 +58,10 @@ static void init_sampler()
     if (values)
 	free(values);
     values = calloc(kbest, sizeof(double));
-#if KEEP_SAMPLES
     if (samples)
 	free(samples);
     /* Allocate extra for wraparound analysis */
     samples = calloc(maxsamples+kbest, sizeof(double));
-#endif
     samplecount = 0;
 }
 
@@ -74,9 +78,7 @@ static void add_sample(double val)
 	pos = kbest-1;
 	values[pos] = val;
     }
-#if KEEP_SAMPLES
     samples[samplecount] = val;
-#endif
     samplecount++;
     /* Insertion sort */
     while (pos > 0 && values[pos-1] > values[pos]) {
@@ -93,10 +95,33 @@ static void add_sample(double val)
 static int has_converged()
 {
     return
-	(samplecount >= kbest) &&
+	(samplecount >= kbest) && (samplecount >= minsamples) &&
 	((1 + epsilon)*values[0] >= values[kbest-1]);
 }
 
+/*
+ * summarize - Compute the mean and the 95% confidence interval of the
+ *     mean over all samples of the last run. The interval uses the
+ *     normal approximation, which is slightly optimistic for the
+ *     handful of samples a converged K-best run usually takes.
+ */
+static void summarize(void)
+{
+    int i;
+    double sum = 0.0, sq = 0.0, var;
+
+    for (i = 0; i < samplecount; i++)
+	sum += samples[i];
+    last_stats.samples = samplecount;
+    last_stats.best = values[0];
+    last_stats.mean = sum / samplecount;
+    for (i = 0; i < samplecount; i++)
+	sq += (samples[i] - last_stats.mean) * (samples[i] - last_stats.mean);
+    var = (samplecount > 1) ? sq / (samplecount - 1) : 0.0;
+    last_stats.stddev = sqrt(var);
+    last_stats.ci = 1.96 * last_stats.stddev / sqrt(samplecount);
+}
+
 /* 
  * clear - Code to clear cache 
  */
@@ -130,7 +155,7 @@ double fcyc(test_funct f, void *argp)
 {
     double result;
     init_sampler();
-    if (compensate) {
+    if (compensate && counter_get == get_counter) {
 	do {
 	    double cyc;
 	    if (clear_cache)
@@ -145,9 +170,9 @@ double fcyc(test_funct f, void *argp)
 	    double cyc;
 	    if (clear_cache)
 		clear();
-	    start_counter();
+	    counter_start();
 	    f(argp);
-	    cyc = get_counter();
+	    cyc = counter_get();
 	    add_sample(cyc);
 	} while (!has_converged() && samplecount < maxsamples);
     }
@@ -160,6 +185,7 @@ double fcyc(test_funct f, void *argp)
     }
 #endif
     result = values[0];
+    summarize();
 #if !KEEP_VALS
     free(values); 
     values = NULL;
@@ -168,10 +194,30 @@ double fcyc(test_funct f, void *argp)
 }
 
 
+/*
+ * fcyc_stats - Describe the samples behind the last fcyc result
+ */
+void fcyc_stats(fcyc_stats_t *stats)
+{
+    *stats = last_stats;
+}
+
+
 /*************************************************************
  * Set the various parameters used by the measurement routines 
  ************************************************************/
 
+/*
+ * set_fcyc_counter - Counter used to time the test function.
+ *     Compensation for timer interrupts only applies to the cycle counter.
+ *     Default = start_counter/get_counter
+ */
+void set_fcyc_counter(counter_start_funct start, counter_get_funct get)
+{
+    counter_start = start;
+    counter_get = get;
+}
+
 /* 
  * set_fcyc_clear_cache - When set, will run code to clear cache 
  *     before each measurement. 
@@ -225,6 +271,17 @@ void set_fcyc_k(int k)
     kbest = k;
 }
 
+/*
+ * set_fcyc_minsamples - Minimum number of samples to take, even when
+ *     the K best have already converged. Raising it tightens the
+ *     confidence interval reported by fcyc_stats.
+ *     Default = 0
+ */
+void set_fcyc_minsamples(int minsamples_arg)
+{
+    minsamples = minsamples_arg;
+}
+
 /* 
  * set_fcyc_maxsamples - Maximum number of samples attempting to find 
  *     K-best within some tolerance.
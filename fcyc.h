@@ -10,13 +10,35 @@
 /* The test function takes a generic pointer as input */
 typedef void (*test_funct)(void *);
 
+/* The counter that fcyc reads around each run of the test function */
+typedef void (*counter_start_funct)(void);
+typedef double (*counter_get_funct)(void);
+
 /* Compute number of cycles used by test function f */
 double fcyc(test_funct f, void* argp);
 
+/* Summary of all samples taken by the most recent call to fcyc */
+typedef struct {
+    int samples;    /* number of times the test function was run */
+    double best;    /* smallest sample (what fcyc returned) */
+    double mean;    /* mean of all samples */
+    double stddev;  /* sample standard deviation */
+    double ci;      /* half-width of the 95% confidence interval of the mean */
+} fcyc_stats_t;
+
+void fcyc_stats(fcyc_stats_t *stats);
+
 /*********************************************************
  * Set the various parameters used by measurement routines 
  *********************************************************/
 
+/*
+ * set_fcyc_counter - Counter used to time the test function.
+ *     Compensation for timer interrupts only applies to the cycle counter.
+ *     Default = start_counter/get_counter
+ */
+void set_fcyc_counter(counter_start_funct start, counter_get_funct get);
+
 /* 
  * set_fcyc_clear_cache - When set, will run code to clear cache 
  *     before each measurement. 
@@ -49,6 +71,14 @@ void set_fcyc_compensate(int compensate_arg);
  */
 void set_fcyc_k(int k);
 
+/*
+ * set_fcyc_minsamples - Minimum number of samples to take, even when
+ *     the K best have already converged. Raising it tightens the
+ *     confidence interval reported by fcyc_stats.
+ *     Default = 0
+ */
+void set_fcyc_minsamples(int minsamples_arg);
+
 /* 
  * set_fcyc_maxsamples - Maximum number of samples attempting to find 
  *     K-best within some tolerance.
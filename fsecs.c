@@ -2,6 +2,7 @@
  * High-level timing wrappers
  ****************************/
 #include <stdio.h>
+#include <string.h>
 #include "fsecs.h"
 #include "fcyc.h"
 #include "clock.h"
@@ -12,6 +13,40 @@ static double Mhz;  /* estimated CPU clock frequency */
 
 extern int verbose; /* -v option in mdriver.c */
 
+/* The timing methods, selectable at runtime with set_fsecs_method */
+typedef enum {FCYC, ITIMER, GETTOD, MONO, TSC} method_t;
+
+static char *method_names[] = {"fcyc", "itimer", "gettod", "mono", "tsc"};
+
+/* The default method comes from the USE_xxx constants in config.h */
+#if USE_FCYC
+static method_t method = FCYC;
+#elif USE_ITIMER
+static method_t method = ITIMER;
+#else
+static method_t method = GETTOD;
+#endif
+
+/* Spread of the samples behind the last fsecs result */
+static fsecs_stats_t last_stats;
+
+/*
+ * set_fsecs_method - select the timing method by name. Returns 0 if
+ *     the name is unknown. Must be called before init_fsecs.
+ */
+int set_fsecs_method(char *name)
+{
+    int i;
+
+    for (i = 0; i < sizeof(method_names) / sizeof(char *); i++) {
+	if (!strcmp(name, method_names[i])) {
+	    method = (method_t) i;
+	    return 1;
+	}
+    }
+    return 0;
+}
+
 /*
  * init_fsecs - initialize the timing package
  */
@@ -19,24 +54,58 @@ void init_fsecs(void)
 {
     Mhz = 0; /* keep gcc -Wall happy */
 
-#if USE_FCYC
-    if (verbose)
-	printf("Measuring performance with a cycle counter.\n");
-
-    /* set key parameters for the fcyc package */
-    set_fcyc_maxsamples(20); 
-    set_fcyc_clear_cache(1);
-    set_fcyc_compensate(1);
-    set_fcyc_epsilon(0.01);
-    set_fcyc_k(3);
-    Mhz = mhz(verbose > 0);
-#elif USE_ITIMER
-    if (verbose)
-	printf("Measuring performance with the interval timer.\n");
-#elif USE_GETTOD
-    if (verbose)
-	printf("Measuring performance with gettimeofday().\n");
-#endif
+    if (method == TSC && !tsc_invariant()) {
+	printf("No invariant TSC on this processor, using CLOCK_MONOTONIC_RAW.\n");
+	method = MONO;
+    }
+
+    switch (method) {
+    case FCYC:
+	if (verbose)
+	    printf("Measuring performance with a cycle counter.\n");
+
+	/* set key parameters for the fcyc package */
+	set_fcyc_maxsamples(20); 
+	set_fcyc_clear_cache(1);
+	set_fcyc_compensate(1);
+	set_fcyc_epsilon(0.01);
+	set_fcyc_k(3);
+	Mhz = mhz(verbose > 0);
+	break;
+    case ITIMER:
+	if (verbose)
+	    printf("Measuring performance with the interval timer.\n");
+	break;
+    case GETTOD:
+	if (verbose)
+	    printf("Measuring performance with gettimeofday().\n");
+	break;
+    case MONO:
+    case TSC:
+	if (method == MONO) {
+	    if (verbose)
+		printf("Measuring performance with CLOCK_MONOTONIC_RAW.\n");
+	    set_fcyc_counter(start_mono_counter, get_mono_counter);
+	    Mhz = 1e3; /* the counter ticks in nanoseconds */
+	} else {
+	    if (verbose)
+		printf("Measuring performance with rdtscp.\n");
+	    set_fcyc_counter(start_tsc_counter, get_tsc_counter);
+	    Mhz = tsc_mhz(verbose > 0);
+	}
+
+	/* 
+	 * Same K-best scheme as fcyc, but always take enough samples
+	 * for a meaningful confidence interval.
+	 */
+	set_fcyc_minsamples(10);
+	set_fcyc_maxsamples(40);
+	set_fcyc_clear_cache(1);
+	set_fcyc_compensate(0);
+	set_fcyc_epsilon(0.01);
+	set_fcyc_k(3);
+	break;
+    }
 }
 
 /*
@@ -44,14 +113,40 @@ void init_fsecs(void)
  */
 double fsecs(fsecs_test_funct f, void *argp) 
 {
-#if USE_FCYC
-    double cycles = fcyc(f, argp);
-    return cycles/(Mhz*1e6);
-#elif USE_ITIMER
-    return ftimer_itimer(f, argp, 10);
-#elif USE_GETTOD
-    return ftimer_gettod(f, argp, 10);
-#endif 
-}
+    double cycles;
+    fcyc_stats_t st;
 
+    switch (method) {
+    case FCYC:
+    case MONO:
+    case TSC:
+	cycles = fcyc(f, argp);
+	fcyc_stats(&st);
+	last_stats.samples = st.samples;
+	last_stats.mean = st.mean/(Mhz*1e6);
+	last_stats.stddev = st.stddev/(Mhz*1e6);
+	last_stats.ci = st.ci/(Mhz*1e6);
+	return cycles/(Mhz*1e6);
+    case ITIMER:
+	last_stats.samples = 1;
+	last_stats.mean = ftimer_itimer(f, argp, 10);
+	last_stats.stddev = last_stats.ci = 0.0;
+	return last_stats.mean;
+    case GETTOD:
+    default:
+	last_stats.samples = 1;
+	last_stats.mean = ftimer_gettod(f, argp, 10);
+	last_stats.stddev = last_stats.ci = 0.0;
+	return last_stats.mean;
+    }
+}
 
+/*
+ * fsecs_stats - Describe the samples behind the last fsecs result.
+ *     The interval timer and gettimeofday average 10 runs into a
+ *     single sample, so they report no spread.
+ */
+void fsecs_stats(fsecs_stats_t *stats)
+{
+    *stats = last_stats;
+}
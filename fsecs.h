@@ -1,4 +1,14 @@
 typedef void (*fsecs_test_funct)(void *);
 
+/* Spread of the samples behind an fsecs result (all in seconds) */
+typedef struct {
+    int samples;     /* number of timed samples */
+    double mean;     /* mean of the samples */
+    double stddev;   /* sample standard deviation */
+    double ci;       /* half-width of the 95% confidence interval of the mean */
+} fsecs_stats_t;
+
+int set_fsecs_method(char *name);
 void init_fsecs(void);
 double fsecs(fsecs_test_funct f, void *argp);
+void fsecs_stats(fsecs_stats_t *stats);
@@ -7,6 +7,7 @@
  * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
  * May not be used, modified, or copied without permission.
  */
+#define _GNU_SOURCE /* for sched_setaffinity */
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -14,11 +15,23 @@
 #include <string.h>
 #include <assert.h>
 #include <float.h>
+#include <math.h>
 #include <time.h>
+#include <getopt.h>
+#include <signal.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
 
 #include "mm.h"
+#include "backend.h"
 #include "memlib.h"
 #include "fsecs.h"
+#include "trace.h"
+#include "mmtrace.h"
+#include "replay.h"
+#include "perfctr.h"
 #include "config.h"
 
 /**********************
@@ -30,6 +43,24 @@
 #define MSGLINE	    2048
 #define HDRLINES       4 /* number of header lines in a trace file */
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
+#define MAXFIELDS     32 /* max number of columns in a results CSV line */
+#define MAXBACKENDS   16 /* max number of packages run by one mdriver */
+
+/* Default sampling interval (in ops) for --timeline */
+#define TIMELINE_EVERY 100
+
+/* --locality: points in each trace where the live set is measured, and
+   buckets of the distances between consecutive allocations (bucket i 
+   holds distances in [2^i, 2^(i+1)) bytes, and 0) */
+#define LOCALITY_SAMPLES 100
+#define LOCALITY_BUCKETS 32
+
+/* --footprint: points in each trace where the resident memory is read */
+#define FOOTPRINT_SAMPLES 100
+
+/* Default tolerances for --baseline comparisons */
+#define THRUPUT_TOL  2.0 /* percent drop in Kops before it can be a regression */
+#define UTIL_TOL     0.1 /* drop in percentage points of util */
 
 /* Returns true if p is ALIGNMENT-byte aligned */
 #define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
@@ -45,43 +76,65 @@ typedef struct range_t {
     struct range_t *next;  /* next list element */
 } range_t;
 
-/* Characterizes a single trace operation (allocator request) */
-typedef struct {
-    enum {ALLOC, FREE, REALLOC} type; /* type of request */
-    int index;                        /* index for free() to use later */
-    int size;                         /* byte size of alloc/realloc request */
-} traceop_t;
-
-/* Holds the information for one trace file*/
-typedef struct {
-    int sugg_heapsize;   /* suggested heap size (unused) */
-    int num_ids;         /* number of alloc/realloc ids */
-    int num_ops;         /* number of distinct requests */
-    int weight;          /* weight for this trace (unused) */
-    traceop_t *ops;      /* array of requests */
-    char **blocks;       /* array of ptrs returned by malloc/realloc... */
-    size_t *block_sizes; /* ... and a corresponding array of payload sizes */
-} trace_t;
-
 /* 
  * Holds the params to the xxx_speed functions, which are timed by fcyc. 
  * This struct is necessary because fcyc accepts only a pointer array
  * as input.
  */
 typedef struct {
+    backend_t *backend;
     trace_t *trace;  
     range_t *ranges;
+    int touch;       /* percent of each payload to touch (--touch) */
 } speed_t;
 
+/* Where a package put the blocks of one trace (--locality) */
+typedef struct {
+    unsigned dist[LOCALITY_BUCKETS]; /* distances from the block allocated
+					before, as in LOCALITY_BUCKETS */
+    int samples;         /* sample points with any live bytes */
+    double lines;        /* mean number of cache lines the live blocks 
+			    lie on, over the samples */
+    double pages;        /* ... and of pages */
+    double line_density; /* mean live bytes / bytes of those lines */
+    double page_density; /* mean live bytes / bytes of those pages */
+} locality_t;
+
+/* The physical memory a package used on one trace (--footprint); all -1
+   if the pass failed */
+typedef struct {
+    double live_peak; /* most payload bytes live at once */
+    double rss_peak;  /* most bytes of physical memory the package used */
+    double rss_end;   /* ... and the bytes it used after the last request */
+} footprint_t;
+
 /* Summarizes the important stats for some malloc function on some trace */
 typedef struct {
-    /* defined for both libc malloc and student malloc package (mm.c) */
+    /* defined for every malloc package */
     double ops;      /* number of ops (malloc/free/realloc) in the trace */
     int valid;       /* was the trace processed correctly by the allocator? */
     double secs;     /* number of secs needed to run the trace */
-
-    /* defined only for the student malloc package */
+    double secs_ci;  /* half-width of the 95% confidence interval of secs */
+    double secs_cv;  /* stddev/mean of secs over the --runs (0 for one run) */
+    double overhead; /* secs of the same run on the null package 
+			(--calibrate), i.e., mdriver's own share of secs */
+    double misses[NUM_PERFCTRS]; /* cache and TLB misses in one run 
+				    (--touch), -1 where not counted */
+
+    /* defined only for packages whose heap comes from memlib */
     double util;     /* space utilization for this trace (always 0 for libc) */
+    double heapsize; /* heap size in bytes at the end of the util pass */
+    mm_stats_t peak; /* where the heap bytes were at peak payload */
+    mm_stats_t end;  /* allocator counters at the end of the util pass */
+
+    /* defined only with --threads */
+    replay_stats_t mt; /* multithreaded replay, one thread per trace thread */
+
+    /* defined only with --locality */
+    locality_t loc;
+
+    /* defined only with --footprint, for every package */
+    footprint_t fp;
 
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
@@ -91,6 +144,14 @@ typedef struct {
  *******************/
 int verbose = 0;        /* global flag for verbose output */
 static int errors = 0;  /* number of errs found when running student malloc */
+static int runs = 1;    /* times each trace is timed (--runs) */
+static int calibrate = 0; /* also time the null package (--calibrate) */
+static int touch_pct = -1;  /* percent of payloads touched (--touch), and 
+			       if >= 0, count cache misses */
+static int use_hint = 0; /* pass packages the suggested heap size (--hint) */
+static volatile int touch_sink; /* where touched bytes are read into */
+static cpu_set_t all_cpus;   /* the CPUs we could run on before --pin */
+static int pinned = 0;       /* set once isolate has pinned us */
 char msg[MSGLINE];      /* for whenever we need to compose an error message */
 
 /* Directory where default tracefiles are found */
@@ -107,27 +168,57 @@ static char *default_tracefiles[] = {
  *********************/
 
 /* these functions manipulate range lists */
-static int add_range(range_t **ranges, char *lo, int size, 
+static int add_range(range_t **ranges, char *lo, int size, int in_heap,
 		     int tracenum, int opnum);
 static void remove_range(range_t **ranges, char *lo);
 static void clear_ranges(range_t **ranges);
 
-/* These functions read, allocate, and free storage for traces */
-static trace_t *read_trace(char *tracedir, char *filename);
-static void free_trace(trace_t *trace);
-
-/* Routines for evaluating the correctness and speed of libc malloc */
-static int eval_libc_valid(trace_t *trace, int tracenum);
-static void eval_libc_speed(void *ptr);
-
 /* Routines for evaluating correctnes, space utilization, and speed 
-   of the student's malloc package in mm.c */
-static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
-static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
-static void eval_mm_speed(void *ptr);
+   of a malloc package */
+static int init_backend(backend_t *b, trace_t *trace);
+static int eval_valid(backend_t *b, trace_t *trace, int tracenum, 
+		      range_t **ranges);
+static double eval_util(backend_t *b, trace_t *trace, mm_stats_t *peak);
+static void eval_speed(void *ptr);
+static void touch_block(char *p, size_t size, int pct, int write);
+static void eval_timeline(backend_t *b, trace_t *trace, char *tracename, 
+			  FILE *fp, int every);
+static void eval_locality(backend_t *b, trace_t *trace, locality_t *loc);
+static void eval_footprint(backend_t *b, trace_t *trace, footprint_t *fp);
+static void start_footprint(char **tracefiles);
+static void run_footprint(backend_t *b, int tracenum, footprint_t *fp);
+static void eval_space(backend_t *b, trace_t *trace, int tracenum, 
+		       range_t **ranges, stats_t *stats);
+static void eval_parallel(backend_t *b, char **tracefiles, int n, 
+			  stats_t *stats, int jobs, int speed);
 
 /* Various helper routines */
+static void time_trace(fsecs_test_funct f, speed_t *params, stats_t *stats);
+static void isolate(int cpu, int prio);
 static void printresults(int n, stats_t *stats);
+static void print_net_kops(double ops, double secs, double overhead);
+static void printbreakdown(int n, stats_t *stats);
+static void printcounters(int n, stats_t *stats);
+static void printmisses(int n, stats_t *stats);
+static void printthreads(int n, stats_t *stats, char **tracefiles);
+static void printlocality(int n, stats_t *stats);
+static void printfootprint(int n, stats_t *stats);
+static void printcomparison(backend_t **selected, stats_t **results, 
+			    int num_backends, int n);
+static void select_backends(char *list, backend_t **selected, 
+			    int *num_backends);
+
+/* Machine-readable results and regression checks against a saved run */
+static void write_results(char *path, int json, char **tracefiles, int n,
+			  backend_t **selected, stats_t **results, 
+			  int num_backends, double perfindex);
+static int compare_baseline(char *path, char **tracefiles, int n,
+			    char *allocator, stats_t *stats, double tol);
+
+static FILE *open_output(char *path);
+#if TRACE_LEVEL >= TRACE_EVENTS
+static void crash_handler(int sig);
+#endif
 static void usage(void);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
@@ -138,28 +229,76 @@ static void app_error(char *msg);
  **************/
 int main(int argc, char **argv)
 {
-    int i;
-    char c;
+    int i, k;
+    int c;
     char **tracefiles = NULL;  /* null-terminated array of trace file names */
     int num_tracefiles = 0;    /* the number of traces in that array */
     trace_t *trace = NULL;     /* stores a single trace file in memory */
     range_t *ranges = NULL;    /* keeps track of block extents for one trace */
-    stats_t *libc_stats = NULL;/* libc stats for each trace */
-    stats_t *mm_stats = NULL;  /* mm (i.e. student) stats for each trace */
+    backend_t *selected[MAXBACKENDS]; /* the malloc packages to evaluate */
+    int num_backends = 0;      /* the number of packages in that array */
+    stats_t *results[MAXBACKENDS]; /* stats for each package and trace */
+    int failures[MAXBACKENDS]; /* errors reported for each package */
+    backend_t *b;              /* the package being evaluated */
+    stats_t *stats;            /* ... and its stats */
     speed_t speed_params;      /* input parameters to the xx_speed routines */ 
 
     int team_check = 1;  /* If set, check team structure (reset by -a) */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    char *json_file = NULL;     /* If set, write results as JSON (--json) */
+    char *csv_file = NULL;      /* If set, write results as CSV (--csv) */
+    char *baseline_file = NULL; /* If set, compare against it (--baseline) */
+    double tolerance = THRUPUT_TOL; /* Kops drop ignored by --baseline */
+    int regressions = 0;
+    char *timeline_file = NULL; /* If set, write heap samples (--timeline) */
+    FILE *timeline_fp = NULL;
+    int timeline_every = TIMELINE_EVERY; /* ops between samples */
+    int replay_mt = 0;   /* If set, also replay threads (--threads) */
+    int locality = 0;    /* If set, analyze block placement (--locality) */
+    int footprint = 0;   /* If set, measure resident memory (--footprint) */
+    int jobs = 1;        /* worker processes for the valid/util passes (-j) */
+    int parallel_speed = 0; /* If set, workers time the traces too */
+    int pin_cpu = -1;    /* If set, run on this CPU only (--pin) */
+    int raise_prio = 0;  /* If set, run at the highest priority (--prio) */
+
+    /* Long-only options */
+    enum {OPT_JSON = 256, OPT_CSV, OPT_BASELINE, OPT_TOLERANCE, 
+	  OPT_TIMELINE, OPT_EVERY, OPT_THREADS, OPT_PARALLEL_SPEED,
+	  OPT_PIN, OPT_PRIO, OPT_RUNS, OPT_CALIBRATE, OPT_TOUCH,
+	  OPT_LOCALITY, OPT_FOOTPRINT, OPT_HINT};
+    static struct option long_options[] = {
+	{"json", required_argument, NULL, OPT_JSON},
+	{"csv", required_argument, NULL, OPT_CSV},
+	{"baseline", required_argument, NULL, OPT_BASELINE},
+	{"tolerance", required_argument, NULL, OPT_TOLERANCE},
+	{"timeline", required_argument, NULL, OPT_TIMELINE},
+	{"every", required_argument, NULL, OPT_EVERY},
+	{"threads", no_argument, NULL, OPT_THREADS},
+	{"parallel-speed", no_argument, NULL, OPT_PARALLEL_SPEED},
+	{"pin", required_argument, NULL, OPT_PIN},
+	{"prio", no_argument, NULL, OPT_PRIO},
+	{"runs", required_argument, NULL, OPT_RUNS},
+	{"calibrate", no_argument, NULL, OPT_CALIBRATE},
+	{"touch", required_argument, NULL, OPT_TOUCH},
+	{"locality", no_argument, NULL, OPT_LOCALITY},
+	{"footprint", no_argument, NULL, OPT_FOOTPRINT},
+	{"hint", no_argument, NULL, OPT_HINT},
+	{NULL, 0, NULL, 0}
+    };
 
     /* temporaries used to compute the performance index */
     double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
-    int numcorrect;
+    int numcorrect, errors_before, num_memlib;
+    double primary_perfindex = 0.0; /* of the first package using memlib */
+    int primary_correct = 0;
+    int primary = -1;
     
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    while ((c = getopt_long(argc, argv, "f:t:T:A:j:hvVgal", 
+			    long_options, NULL)) != EOF) {
         switch (c) {
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
@@ -179,12 +318,85 @@ int main(int argc, char **argv)
 	    if (tracedir[strlen(tracedir)-1] != '/') 
 		strcat(tracedir, "/"); /* path always ends with "/" */
 	    break;
+	case 'T': /* Timing method */
+	    if (!set_fsecs_method(optarg)) {
+		printf("Unknown timing method %s\n", optarg);
+		usage();
+		exit(1);
+	    }
+	    break;
+	case OPT_JSON: /* Write per-trace results as JSON */
+	    json_file = optarg;
+	    break;
+	case OPT_CSV: /* Write per-trace results as CSV */
+	    csv_file = optarg;
+	    break;
+	case OPT_BASELINE: /* Compare against results saved with --csv */
+	    baseline_file = optarg;
+	    break;
+	case OPT_TOLERANCE: /* Kops drop (percent) to ignore in --baseline */
+	    tolerance = atof(optarg);
+	    break;
+	case OPT_TIMELINE: /* Sample the heap over the course of each trace */
+	    timeline_file = optarg;
+	    break;
+	case OPT_EVERY: /* Ops between --timeline samples */
+	    timeline_every = atoi(optarg);
+	    if (timeline_every < 1)
+		timeline_every = 1;
+	    break;
+	case OPT_THREADS: /* Replay each trace thread on a thread of its own */
+	    replay_mt = 1;
+	    break;
+	case OPT_PARALLEL_SPEED: /* Let the -j workers time the traces too */
+	    parallel_speed = 1;
+	    break;
+	case OPT_PIN: /* Run on this CPU only */
+	    pin_cpu = atoi(optarg);
+	    break;
+	case OPT_PRIO: /* Run at the highest scheduling priority */
+	    raise_prio = 1;
+	    break;
+	case OPT_RUNS: /* Time each trace this many times */
+	    runs = atoi(optarg);
+	    if (runs < 1)
+		runs = 1;
+	    break;
+	case OPT_CALIBRATE: /* Time mdriver's own loop on each trace too */
+	    calibrate = 1;
+	    break;
+	case OPT_LOCALITY: /* Analyze where the blocks are placed */
+	    locality = 1;
+	    break;
+	case OPT_FOOTPRINT: /* Measure the physical memory used */
+	    footprint = 1;
+	    break;
+	case OPT_HINT: /* Pass the suggested heap size to mm_init_hint */
+	    use_hint = 1;
+	    break;
+	case OPT_TOUCH: /* Touch this percent of each payload */
+	    touch_pct = atoi(optarg);
+	    if (touch_pct < 0 || touch_pct > 100) {
+		printf("--touch takes a percentage, 0 to 100\n");
+		exit(1);
+	    }
+	    break;
+	case 'j': /* Evaluate this many traces at once, 0 for one per CPU */
+	    jobs = atoi(optarg);
+	    if (jobs < 1)
+		jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	    if (jobs < 1)
+		jobs = 1;
+	    break;
         case 'a': /* Don't check team structure */
             team_check = 0;
             break;
         case 'l': /* Run libc malloc */
             run_libc = 1;
             break;
+	case 'A': /* Run these malloc packages (comma-separated names) */
+	    select_backends(optarg, selected, &num_backends);
+	    break;
         case 'v': /* Print per-trace performance breakdown */
             verbose = 1;
             break;
@@ -239,131 +451,228 @@ int main(int argc, char **argv)
     /* Initialize the timing package */
     init_fsecs();
 
-    /*
-     * Optionally run and evaluate the libc malloc package 
+#if TRACE_LEVEL >= TRACE_EVENTS
+    /* If an allocator crashes, show the last requests it logged */
+    signal(SIGSEGV, crash_handler);
+    signal(SIGBUS, crash_handler);
+    signal(SIGABRT, crash_handler);
+#endif
+
+    /* 
+     * Run mm.c unless -A says otherwise, and -l puts libc in front
      */
+    if (num_backends == 0)
+	selected[num_backends++] = backends[0];
     if (run_libc) {
+	for (k = 0; k < num_backends; k++)
+	    if (!strcmp(selected[k]->name, "libc"))
+		break;
+	if (k == num_backends && num_backends < MAXBACKENDS) {
+	    memmove(selected + 1, selected, num_backends * sizeof(backend_t *));
+	    selected[0] = find_backend("libc");
+	    num_backends++;
+	}
+    }
+
+    /* Initialize the simulated memory system in memlib.c */
+    mem_init(); 
+
+    /* Keep the scheduler from moving or preempting us while we time */
+    if (pin_cpu >= 0 || raise_prio)
+	isolate(pin_cpu, raise_prio);
+
+    /* Before any package runs and leaves memory behind */
+    if (footprint)
+	start_footprint(tracefiles);
+
+    if (timeline_file) {
+	timeline_fp = open_output(timeline_file);
+	fprintf(timeline_fp, "allocator,trace,op,live_bytes,heap_bytes,"
+		"free_blocks,free_bytes,largest_free,ext_frag\n");
+    }
+
+    /*
+     * Run and evaluate each of the selected malloc packages in turn
+     */
+    for (k = 0; k < num_backends; k++) {
+	b = selected[k];
 	if (verbose > 1)
-	    printf("\nTesting libc malloc\n");
-	
-	/* Allocate libc stats array, with one stats_t struct per tracefile */
-	libc_stats = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
-	if (libc_stats == NULL)
-	    unix_error("libc_stats calloc in main failed");
-	
-	/* Evaluate the libc malloc package using the K-best scheme */
+	    printf("\nTesting %s malloc\n", b->name);
+
+	/* Allocate the stats array, with one stats_t struct per tracefile */
+	results[k] = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
+	if (results[k] == NULL)
+	    unix_error("results calloc in main failed");
+	stats = results[k];
+	errors_before = errors;
+
+	/* With -j, worker processes do the valid and util passes first */
+	if (jobs > 1)
+	    eval_parallel(b, tracefiles, num_tracefiles, stats, jobs, 
+			  parallel_speed);
+
+	/* Evaluate the malloc package using the K-best scheme */
 	for (i=0; i < num_tracefiles; i++) {
+	    if (jobs > 1 && (!stats[i].valid || 
+			     (parallel_speed && !timeline_fp && !replay_mt &&
+			      !locality && !footprint)))
+		continue;
 	    trace = read_trace(tracedir, tracefiles[i]);
-	    libc_stats[i].ops = trace->num_ops;
-	    if (verbose > 1)
-		printf("Checking libc malloc for correctness, ");
-	    libc_stats[i].valid = eval_libc_valid(trace, i);
-	    if (libc_stats[i].valid) {
-		speed_params.trace = trace;
-		if (verbose > 1)
-		    printf("and performance.\n");
-		libc_stats[i].secs = fsecs(eval_libc_speed, &speed_params);
+	    if (jobs == 1)
+		eval_space(b, trace, i, &ranges, &stats[i]);
+	    if (stats[i].valid) {
+		if (timeline_fp && b->uses_memlib && b->stats)
+		    eval_timeline(b, trace, tracefiles[i], timeline_fp, 
+				  timeline_every);
+		if (locality)
+		    eval_locality(b, trace, &stats[i].loc);
+		if (footprint)
+		    run_footprint(b, i, &stats[i].fp);
+		if (jobs == 1 || !parallel_speed) {
+		    speed_params.backend = b;
+		    speed_params.trace = trace;
+		    speed_params.ranges = ranges;
+		    speed_params.touch = touch_pct;
+		    if (verbose > 1)
+			printf("Timing %s malloc.\n", b->name);
+		    time_trace(eval_speed, &speed_params, &stats[i]);
+		}
+		if (replay_mt && 
+		    replay_threads(b, trace, &stats[i].mt) < 0) {
+		    malloc_error(i, 0, "a request failed in the "
+				 "multithreaded replay");
+		    stats[i].valid = 0;
+		}
 	    }
 	    free_trace(trace);
 	}
+	failures[k] = errors - errors_before;
 
-	/* Display the libc results in a compact table */
+	/* Display the results in a compact table */
 	if (verbose) {
-	    printf("\nResults for libc malloc:\n");
-	    printresults(num_tracefiles, libc_stats);
+	    printf("\nResults for %s malloc:\n", b->name);
+	    printresults(num_tracefiles, stats);
+	    printf("\n");
+	    if (b->stats) {
+		printbreakdown(num_tracefiles, stats);
+		printf("\n");
+		if (verbose > 1) {
+		    printcounters(num_tracefiles, stats);
+		    printf("\n");
+		}
+	    }
+	    if (touch_pct >= 0) {
+		printmisses(num_tracefiles, stats);
+		printf("\n");
+	    }
+	}
+	if (replay_mt) {
+	    printf("\nMultithreaded replay of %s malloc:\n", b->name);
+	    printthreads(num_tracefiles, stats, tracefiles);
+	    printf("\n");
+	}
+	if (locality) {
+	    printf("\nPlacement of blocks by %s malloc:\n", b->name);
+	    printlocality(num_tracefiles, stats);
+	    printf("\n");
+	}
+	if (footprint) {
+	    printf("\nResident memory of %s malloc:\n", b->name);
+	    printfootprint(num_tracefiles, stats);
+	    printf("\n");
 	}
     }
 
-    /*
-     * Always run and evaluate the student's mm package
-     */
-    if (verbose > 1)
-	printf("\nTesting mm malloc\n");
-
-    /* Allocate the mm stats array, with one stats_t struct per tracefile */
-    mm_stats = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
-    if (mm_stats == NULL)
-	unix_error("mm_stats calloc in main failed");
-    
-    /* Initialize the simulated memory system in memlib.c */
-    mem_init(); 
-
-    /* Evaluate student's mm malloc package using the K-best scheme */
-    for (i=0; i < num_tracefiles; i++) {
-	trace = read_trace(tracedir, tracefiles[i]);
-	mm_stats[i].ops = trace->num_ops;
-	if (verbose > 1)
-	    printf("Checking mm_malloc for correctness, ");
-	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges);
-	if (mm_stats[i].valid) {
-	    if (verbose > 1)
-		printf("efficiency, ");
-	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
-	    speed_params.trace = trace;
-	    speed_params.ranges = ranges;
-	    if (verbose > 1)
-		printf("and performance.\n");
-	    mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
-	}
-	free_trace(trace);
-    }
-
-    /* Display the mm results in a compact table */
-    if (verbose) {
-	printf("\nResults for mm malloc:\n");
-	printresults(num_tracefiles, mm_stats);
-	printf("\n");
-    }
+    if (timeline_fp && timeline_fp != stdout)
+	fclose(timeline_fp);
 
-    /* 
-     * Accumulate the aggregate statistics for the student's mm package 
-     */
-    secs = 0;
-    ops = 0;
-    util = 0;
-    numcorrect = 0;
-    for (i=0; i < num_tracefiles; i++) {
-	secs += mm_stats[i].secs;
-	ops += mm_stats[i].ops;
-	util += mm_stats[i].util;
-	if (mm_stats[i].valid)
-	    numcorrect++;
-    }
-    avg_mm_util = util/num_tracefiles;
+    if (num_backends > 1)
+	printcomparison(selected, results, num_backends, num_tracefiles);
 
     /* 
-     * Compute and print the performance index 
+     * Compute and print the performance index of every package whose 
+     * heap comes from memlib. The first one is the package that the
+     * autograder and the results files report.
      */
-    if (errors == 0) {
-	avg_mm_throughput = ops/secs;
-
-	p1 = UTIL_WEIGHT * avg_mm_util;
-	if (avg_mm_throughput > AVG_LIBC_THRUPUT) {
-	    p2 = (double)(1.0 - UTIL_WEIGHT);
-	} 
-	else {
-	    p2 = ((double) (1.0 - UTIL_WEIGHT)) * 
-		(avg_mm_throughput/AVG_LIBC_THRUPUT);
+    num_memlib = 0;
+    for (k = 0; k < num_backends; k++)
+	num_memlib += selected[k]->uses_memlib;
+    for (k = 0; k < num_backends; k++) {
+	b = selected[k];
+	if (!b->uses_memlib)
+	    continue;
+
+	/* Accumulate the aggregate statistics for the package */
+	secs = 0;
+	ops = 0;
+	util = 0;
+	numcorrect = 0;
+	for (i=0; i < num_tracefiles; i++) {
+	    secs += results[k][i].secs;
+	    ops += results[k][i].ops;
+	    util += results[k][i].util;
+	    if (results[k][i].valid)
+		numcorrect++;
 	}
+	avg_mm_util = util/num_tracefiles;
+
+	if (num_memlib > 1)
+	    printf("%s: ", b->name);
+	if (failures[k] == 0) {
+	    avg_mm_throughput = ops/secs;
+
+	    p1 = UTIL_WEIGHT * avg_mm_util;
+	    if (avg_mm_throughput > AVG_LIBC_THRUPUT) {
+		p2 = (double)(1.0 - UTIL_WEIGHT);
+	    } 
+	    else {
+		p2 = ((double) (1.0 - UTIL_WEIGHT)) * 
+		    (avg_mm_throughput/AVG_LIBC_THRUPUT);
+	    }
 	
-	perfindex = (p1 + p2)*100.0;
-	printf("Perf index = %.0f (util) + %.0f (thru) = %.0f/100\n",
-	       p1*100, 
-	       p2*100, 
-	       perfindex);
-	
-    }
-    else { /* There were errors */
-	perfindex = 0.0;
-	printf("Terminated with %d errors\n", errors);
+	    perfindex = (p1 + p2)*100.0;
+	    printf("Perf index = %.0f (util) + %.0f (thru) = %.0f/100\n",
+		   p1*100, 
+		   p2*100, 
+		   perfindex);
+	}
+	else { /* There were errors */
+	    perfindex = 0.0;
+	    printf("Terminated with %d errors\n", failures[k]);
+	}
+
+	if (primary < 0) {
+	    primary = k;
+	    primary_perfindex = perfindex;
+	    primary_correct = numcorrect;
+	}
     }
 
     if (autograder) {
-	printf("correct:%d\n", numcorrect);
-	printf("perfidx:%.0f\n", perfindex);
+	printf("correct:%d\n", primary_correct);
+	printf("perfidx:%.0f\n", primary_perfindex);
+    }
+
+    /* 
+     * Emit the machine-readable results and check for regressions. Only
+     * our own packages count towards the exit status, not libc.
+     */
+    if (csv_file)
+	write_results(csv_file, 0, tracefiles, num_tracefiles,
+		      selected, results, num_backends, primary_perfindex);
+    if (json_file)
+	write_results(json_file, 1, tracefiles, num_tracefiles,
+		      selected, results, num_backends, primary_perfindex);
+    if (baseline_file) {
+	for (k = 0; k < num_backends; k++) {
+	    c = compare_baseline(baseline_file, tracefiles, num_tracefiles,
+				 selected[k]->name, results[k], tolerance);
+	    if (selected[k]->uses_memlib)
+		regressions += c;
+	}
     }
 
-    exit(0);
+    exit(regressions ? 2 : 0);
 }
 
 
@@ -378,8 +687,9 @@ int main(int argc, char **argv)
  *     we've just called the student's mm_malloc to allocate a block of 
  *     size bytes at addr lo. After checking the block for correctness,
  *     we create a range struct for this block and add it to the range list. 
+ *     Blocks must lie in the memlib heap only if in_heap is set.
  */
-static int add_range(range_t **ranges, char *lo, int size, 
+static int add_range(range_t **ranges, char *lo, int size, int in_heap,
 		     int tracenum, int opnum)
 {
     char *hi = lo + size - 1;
@@ -397,8 +707,9 @@ static int add_range(range_t **ranges, char *lo, int size,
     }
 
     /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
-	(hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
+    if (in_heap && 
+	((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
+	 (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi()))) {
 	sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
 		lo, hi, mem_heap_lo(), mem_heap_hi());
 	malloc_error(tracenum, opnum, msg);
@@ -466,119 +777,28 @@ static void clear_ranges(range_t **ranges)
 }
 
 
-/**********************************************
- * The following routines manipulate tracefiles
- *********************************************/
-
-/*
- * read_trace - read a trace file and store it in memory
- */
-static trace_t *read_trace(char *tracedir, char *filename)
-{
-    FILE *tracefile;
-    trace_t *trace;
-    char type[MAXLINE];
-    char path[MAXLINE];
-    unsigned index, size;
-    unsigned max_index = 0;
-    unsigned op_index;
-    int ferr;
-
-    if (verbose > 1)
-	printf("Reading tracefile: %s\n", filename);
-
-    /* Allocate the trace record */
-    if ((trace = (trace_t *) malloc(sizeof(trace_t))) == NULL)
-	unix_error("malloc 1 failed in read_trance");
-	
-    /* Read the trace file header */
-    strcpy(path, tracedir);
-    strcat(path, filename);
-    if ((tracefile = fopen(path, "r")) == NULL) {
-	sprintf(msg, "Could not open %s in read_trace", path);
-	unix_error(msg);
-    }
-    ferr = fscanf(tracefile, "%d", &(trace->sugg_heapsize)); /* not used */
-    ferr = fscanf(tracefile, "%d", &(trace->num_ids));     
-    ferr = fscanf(tracefile, "%d", &(trace->num_ops));     
-    ferr = fscanf(tracefile, "%d", &(trace->weight));        /* not used */
-    
-    /* We'll store each request line in the trace in this array */
-    if ((trace->ops = 
-	 (traceop_t *)malloc(trace->num_ops * sizeof(traceop_t))) == NULL)
-	unix_error("malloc 2 failed in read_trace");
-
-    /* We'll keep an array of pointers to the allocated blocks here... */
-    if ((trace->blocks = 
-	 (char **)malloc(trace->num_ids * sizeof(char *))) == NULL)
-	unix_error("malloc 3 failed in read_trace");
-
-    /* ... along with the corresponding byte sizes of each block */
-    if ((trace->block_sizes = 
-	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
-	unix_error("malloc 4 failed in read_trace");
-    
-    /* read every request line in the trace file */
-    index = 0;
-    op_index = 0;
-    while (fscanf(tracefile, "%s", type) != EOF) {
-	switch(type[0]) {
-	case 'a':
-	    ferr = fscanf(tracefile, "%u %u", &index, &size);
-	    trace->ops[op_index].type = ALLOC;
-	    trace->ops[op_index].index = index;
-	    trace->ops[op_index].size = size;
-	    max_index = (index > max_index) ? index : max_index;
-	    break;
-	case 'r':
-	    ferr = fscanf(tracefile, "%u %u", &index, &size);
-	    trace->ops[op_index].type = REALLOC;
-	    trace->ops[op_index].index = index;
-	    trace->ops[op_index].size = size;
-	    max_index = (index > max_index) ? index : max_index;
-	    break;
-	case 'f':
-	    ferr = fscanf(tracefile, "%ud", &index);
-	    trace->ops[op_index].type = FREE;
-	    trace->ops[op_index].index = index;
-	    break;
-	default:
-	    printf("Bogus type character (%c) in tracefile %s\n", 
-		   type[0], path);
-	    exit(1);
-	}
-	op_index++;
-	ferr = 2 * ferr + size;
-	
-    }
-    fclose(tracefile);
-    assert(max_index == trace->num_ids - 1);
-    assert(trace->num_ops == op_index);
-    
-    return trace;
-}
+/**********************************************************************
+ * The following functions evaluate the correctness, space utilization,
+ * and throughput of a malloc package, reached through its backend.
+ **********************************************************************/
 
 /*
- * free_trace - Free the trace record and the three arrays it points
- *              to, all of which were allocated in read_trace().
+ * init_backend - reset a malloc package for a run of trace; with --hint,
+ *     through its mm_init_hint, if it has one, with the trace's suggested
+ *     heap size
  */
-void free_trace(trace_t *trace)
+static int init_backend(backend_t *b, trace_t *trace)
 {
-    free(trace->ops);         /* free the three arrays... */
-    free(trace->blocks);      
-    free(trace->block_sizes);
-    free(trace);              /* and the trace record itself... */
+    if (use_hint && b->init_hint && trace->sugg_heapsize > 0)
+	return b->init_hint(trace->sugg_heapsize);
+    return b->init();
 }
 
-/**********************************************************************
- * The following functions evaluate the correctness, space utilization,
- * and throughput of the libc and mm malloc packages.
- **********************************************************************/
-
 /*
- * eval_mm_valid - Check the mm malloc package for correctness
+ * eval_valid - Check a malloc package for correctness
  */
-static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) 
+static int eval_valid(backend_t *b, trace_t *trace, int tracenum, 
+		      range_t **ranges) 
 {
     int i, j;
     int index;
@@ -589,11 +809,12 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
     char *p;
     
     /* Reset the heap and free any records in the range list */
-    mem_reset_brk();
+    if (b->uses_memlib)
+	mem_reset_brk();
     clear_ranges(ranges);
 
-    /* Call the mm package's init function */
-    if (mm_init() < 0) {
+    /* Call the package's init function */
+    if (init_backend(b, trace) < 0) {
 	malloc_error(tracenum, 0, "mm_init failed.");
 	return 0;
     }
@@ -608,7 +829,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
         case ALLOC: /* mm_malloc */
 
 	    /* Call the student's malloc */
-	    if ((p = mm_malloc(size)) == NULL) {
+	    if ((p = b->malloc(size)) == NULL) {
 		malloc_error(tracenum, i, "mm_malloc failed.");
 		return 0;
 	    }
@@ -618,7 +839,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	     * to the range list if OK. The block must be  be aligned properly,
 	     * and must not overlap any currently allocated block. 
 	     */ 
-	    if (add_range(ranges, p, size, tracenum, i) == 0)
+	    if (add_range(ranges, p, size, b->uses_memlib, tracenum, i) == 0)
 		return 0;
 	    
 	    /* ADDED: cgw
@@ -637,7 +858,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    
 	    /* Call the student's realloc */
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_realloc(oldp, size)) == NULL) {
+	    if ((newp = b->realloc(oldp, size)) == NULL) {
 		malloc_error(tracenum, i, "mm_realloc failed.");
 		return 0;
 	    }
@@ -646,7 +867,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    remove_range(ranges, oldp);
 	    
 	    /* Check new block for correctness and add it to range list */
-	    if (add_range(ranges, newp, size, tracenum, i) == 0)
+	    if (add_range(ranges, newp, size, b->uses_memlib, tracenum, i) == 0)
 		return 0;
 	    
 	    /* ADDED: cgw
@@ -657,7 +878,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    oldsize = trace->block_sizes[index];
 	    if (size < oldsize) oldsize = size;
 	    for (j = 0; j < oldsize; j++) {
-	      if (newp[j] != (index & 0xFF)) {
+	      if ((unsigned char)newp[j] != (index & 0xFF)) {
 		malloc_error(tracenum, i, "mm_realloc did not preserve the "
 			     "data from old block");
 		return 0;
@@ -675,21 +896,28 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Remove region from list and call student's free function */
 	    p = trace->blocks[index];
 	    remove_range(ranges, p);
-	    mm_free(p);
+	    b->free(p);
 	    break;
 
 	default:
-	    app_error("Nonexistent request type in eval_mm_valid");
+	    app_error("Nonexistent request type in eval_valid");
         }
 
     }
 
+    /* Let the package check its own heap, if it can */
+    if (b->check && !b->check()) {
+	malloc_error(tracenum, trace->num_ops - 1, 
+		     "heap check failed at the end of the trace");
+	return 0;
+    }
+
     /* As far as we know, this is a valid malloc package */
     return 1;
 }
 
 /* 
- * eval_mm_util - Evaluate the space utilization of the student's package
+ * eval_util - Evaluate the space utilization of a package
  *   The idea is to remember the high water mark "hwm" of the heap for 
  *   an optimal allocator, i.e., no gaps and no internal fragmentation.
  *   Utilization is the ratio hwm/heapsize, where heapsize is the 
@@ -697,9 +925,11 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
  *   package on the trace. Note that our implementation of mem_sbrk() 
  *   doesn't allow the students to decrement the brk pointer, so brk
  *   is always the high water mark of the heap. 
- *   
+ *
+ *   If the package provides mm_stats, its breakdown of the heap at the 
+ *   point of peak payload is left in *peak.
  */
-static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
+static double eval_util(backend_t *b, trace_t *trace, mm_stats_t *peak)
 {   
     int i;
     int index;
@@ -711,8 +941,8 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 
     /* initialize the heap and the mm malloc package */
     mem_reset_brk();
-    if (mm_init() < 0)
-	app_error("mm_init failed in eval_mm_util");
+    if (init_backend(b, trace) < 0)
+	app_error("mm_init failed in eval_util");
 
     for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
@@ -721,8 +951,8 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
 
-	    if ((p = mm_malloc(size)) == NULL) 
-		app_error("mm_malloc failed in eval_mm_util");
+	    if ((p = b->malloc(size)) == NULL) 
+		app_error("mm_malloc failed in eval_util");
 	    
 	    /* Remember region and size */
 	    trace->blocks[index] = p;
@@ -733,8 +963,11 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    total_size += size;
 	    
 	    /* Update statistics */
-	    max_total_size = (total_size > max_total_size) ?
-		total_size : max_total_size;
+	    if (total_size > max_total_size) {
+		max_total_size = total_size;
+		if (b->stats)
+		    b->stats(peak);
+	    }
 	    break;
 
 	case REALLOC: /* mm_realloc */
@@ -743,8 +976,8 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    oldsize = trace->block_sizes[index];
 
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_realloc(oldp,newsize)) == NULL)
-		app_error("mm_realloc failed in eval_mm_util");
+	    if ((newp = b->realloc(oldp,newsize)) == NULL)
+		app_error("mm_realloc failed in eval_util");
 
 	    /* Remember region and size */
 	    trace->blocks[index] = newp;
@@ -755,8 +988,11 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    total_size += (newsize - oldsize);
 	    
 	    /* Update statistics */
-	    max_total_size = (total_size > max_total_size) ?
-		total_size : max_total_size;
+	    if (total_size > max_total_size) {
+		max_total_size = total_size;
+		if (b->stats)
+		    b->stats(peak);
+	    }
 	    break;
 
         case FREE: /* mm_free */
@@ -764,7 +1000,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    size = trace->block_sizes[index];
 	    p = trace->blocks[index];
 	    
-	    mm_free(p);
+	    b->free(p);
 	    
 	    /* Keep track of current total size
 	     * of all allocated blocks */
@@ -773,7 +1009,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    break;
 
 	default:
-	    app_error("Nonexistent request type in eval_mm_util");
+	    app_error("Nonexistent request type in eval_util");
 
         }
     }
@@ -783,19 +1019,26 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 
 
 /*
- * eval_mm_speed - This is the function that is used by fcyc()
- *    to measure the running time of the mm malloc package.
+ * eval_speed - This is the function that is used by fcyc()
+ *    to measure the running time of a malloc package. With --touch,
+ *    it also writes to each block when it is allocated, reads it back
+ *    before it is freed, and reads the moved part after a realloc, as
+ *    a program would.
  */
-static void eval_mm_speed(void *ptr)
+static void eval_speed(void *ptr)
 {
     int i, index, size, newsize;
     char *p, *newp, *oldp, *block;
+    backend_t *b = ((speed_t *)ptr)->backend;
     trace_t *trace = ((speed_t *)ptr)->trace;
+    int touch = ((speed_t *)ptr)->touch;
+    size_t *sizes = trace->block_sizes;
 
-    /* Reset the heap and initialize the mm package */
-    mem_reset_brk();
-    if (mm_init() < 0) 
-	app_error("mm_init failed in eval_mm_speed");
+    /* Reset the heap and initialize the package */
+    if (b->uses_memlib)
+	mem_reset_brk();
+    if (init_backend(b, trace) < 0) 
+	app_error("mm_init failed in eval_speed");
 
     /* Interpret each trace request */
     for (i = 0;  i < trace->num_ops;  i++)
@@ -804,114 +1047,561 @@ static void eval_mm_speed(void *ptr)
         case ALLOC: /* mm_malloc */
             index = trace->ops[i].index;
             size = trace->ops[i].size;
-            if ((p = mm_malloc(size)) == NULL)
-		app_error("mm_malloc error in eval_mm_speed");
+            if ((p = b->malloc(size)) == NULL)
+		app_error("mm_malloc error in eval_speed");
             trace->blocks[index] = p;
+	    if (touch > 0) {
+		sizes[index] = size;
+		touch_block(p, size, touch, 1);
+	    }
             break;
 
 	case REALLOC: /* mm_realloc */
 	    index = trace->ops[i].index;
             newsize = trace->ops[i].size;
 	    oldp = trace->blocks[index];
-            if ((newp = mm_realloc(oldp,newsize)) == NULL)
-		app_error("mm_realloc error in eval_mm_speed");
+            if ((newp = b->realloc(oldp,newsize)) == NULL)
+		app_error("mm_realloc error in eval_speed");
             trace->blocks[index] = newp;
+	    if (touch > 0) {
+		touch_block(newp, sizes[index] < newsize ? sizes[index] : 
+			    newsize, touch, 0);
+		sizes[index] = newsize;
+		touch_block(newp, newsize, touch, 1);
+	    }
             break;
 
         case FREE: /* mm_free */
             index = trace->ops[i].index;
             block = trace->blocks[index];
-            mm_free(block);
+	    if (touch > 0)
+		touch_block(block, sizes[index], touch, 0);
+            b->free(block);
             break;
 
 	default:
-	    app_error("Nonexistent request type in eval_mm_valid");
+	    app_error("Nonexistent request type in eval_speed");
         }
 }
 
 /*
- * eval_libc_valid - We run this function to make sure that the
- *    libc malloc can run to completion on the set of traces.
- *    We'll be conservative and terminate if any libc malloc call fails.
- *
+ * touch_block - write to (or read) one byte in each cache line of the 
+ *     first pct percent of the size bytes at p
  */
-static int eval_libc_valid(trace_t *trace, int tracenum)
+static void touch_block(char *p, size_t size, int pct, int write)
 {
-    int i, newsize;
+    char *end = p + size * pct / 100;
+    int sum = 0;
+
+    for (; p < end; 
+	 p = (char *)(((size_t)p + CACHE_LINE) & ~(size_t)(CACHE_LINE - 1))) {
+	if (write)
+	    *p = (char)size;
+	else
+	    sum += *p;
+    }
+    if (!write)
+	touch_sink += sum;
+}
+
+/*
+ * sample_heap - write one --timeline line describing the current heap
+ */
+static void sample_heap(backend_t *b, FILE *fp, char *tracename, int op, 
+			int live)
+{
+    mm_stats_t st;
+
+    b->stats(&st);
+    fprintf(fp, "%s,%s,%d,%d,%u,%u,%u,%u,%.4f\n", b->name, tracename, op, live,
+	    (unsigned) mem_heapsize(), (unsigned) st.free_blocks, 
+	    (unsigned) st.free_bytes, (unsigned) st.largest_free,
+	    st.free_bytes ? 1.0 - (double) st.largest_free / st.free_bytes : 0.0);
+}
+
+/*
+ * eval_timeline - Replay the trace once more, writing a CSV line with
+ *    the live payload, the heap size and the state of the free blocks
+ *    every "every" ops (and after the last op). The external 
+ *    fragmentation column is 1 - largest free block / free bytes: 0 
+ *    when all free space is in one block, approaching 1 as it splinters.
+ */
+static void eval_timeline(backend_t *b, trace_t *trace, char *tracename, 
+			  FILE *fp, int every)
+{
+    int i;
+    int index, size, newsize, oldsize;
+    int total_size = 0;
     char *p, *newp, *oldp;
 
+    mem_reset_brk();
+    if (init_backend(b, trace) < 0)
+	app_error("mm_init failed in eval_timeline");
+    sample_heap(b, fp, tracename, 0, 0);
+
     for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
         switch (trace->ops[i].type) {
 
-        case ALLOC: /* malloc */
-	    if ((p = malloc(trace->ops[i].size)) == NULL) {
-		malloc_error(tracenum, i, "libc malloc failed");
-		unix_error("System message");
-	    }
-	    trace->blocks[trace->ops[i].index] = p;
+        case ALLOC: /* mm_malloc */
+	    size = trace->ops[i].size;
+	    if ((p = b->malloc(size)) == NULL) 
+		app_error("mm_malloc failed in eval_timeline");
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    total_size += size;
 	    break;
 
-	case REALLOC: /* realloc */
-            newsize = trace->ops[i].size;
-	    oldp = trace->blocks[trace->ops[i].index];
-	    if ((newp = realloc(oldp, newsize)) == NULL) {
-		malloc_error(tracenum, i, "libc realloc failed");
-		unix_error("System message");
-	    }
-	    trace->blocks[trace->ops[i].index] = newp;
+	case REALLOC: /* mm_realloc */
+	    newsize = trace->ops[i].size;
+	    oldsize = trace->block_sizes[index];
+	    oldp = trace->blocks[index];
+	    if ((newp = b->realloc(oldp,newsize)) == NULL)
+		app_error("mm_realloc failed in eval_timeline");
+	    trace->blocks[index] = newp;
+	    trace->block_sizes[index] = newsize;
+	    total_size += (newsize - oldsize);
 	    break;
-	    
-        case FREE: /* free */
-	    free(trace->blocks[trace->ops[i].index]);
+
+        case FREE: /* mm_free */
+	    b->free(trace->blocks[index]);
+	    total_size -= trace->block_sizes[index];
+	    break;
+
+	default:
+	    app_error("Nonexistent request type in eval_timeline");
+        }
+
+	if ((i + 1) % every == 0 || i == trace->num_ops - 1)
+	    sample_heap(b, fp, tracename, i + 1, total_size);
+    }
+}
+
+/*
+ * compare_blocks - qsort order of (lo, hi) address pairs, by lo
+ */
+static int compare_blocks(const void *a, const void *b)
+{
+    size_t x = ((size_t *)a)[0], y = ((size_t *)b)[0];
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * count_units - number of aligned units of unit bytes (a power of two)
+ *     that the n blocks in the sorted (lo, hi) pairs lie on
+ */
+static double count_units(size_t *blocks, int n, size_t unit)
+{
+    size_t first, last, prev = 0;
+    double count = 0;
+    int i, any = 0;
+
+    for (i = 0; i < n; i++) {
+	first = blocks[2*i] / unit;
+	last = (blocks[2*i+1] - 1) / unit;
+	if (any && first <= prev)
+	    first = prev + 1;   /* shared with an earlier block */
+	if (first <= last)
+	    count += last - first + 1;
+	if (!any || last > prev)
+	    prev = last;
+	any = 1;
+    }
+    return count;
+}
+
+/*
+ * sample_locality - count the cache lines and pages the live blocks of
+ *     the trace lie on, and add them to the means in *loc
+ */
+static void sample_locality(trace_t *trace, size_t *blocks, locality_t *loc)
+{
+    int i, n = 0;
+    double live = 0, lines, pages;
+    size_t page = mem_pagesize();
+
+    for (i = 0; i < trace->num_ids; i++)
+	if (trace->blocks[i] != NULL && trace->block_sizes[i] > 0) {
+	    blocks[2*n] = (size_t)trace->blocks[i];
+	    blocks[2*n+1] = blocks[2*n] + trace->block_sizes[i];
+	    live += trace->block_sizes[i];
+	    n++;
+	}
+    if (n == 0)
+	return;
+    qsort(blocks, n, 2 * sizeof(size_t), compare_blocks);
+
+    lines = count_units(blocks, n, CACHE_LINE);
+    pages = count_units(blocks, n, page);
+    loc->samples++;
+    loc->lines += (lines - loc->lines) / loc->samples;
+    loc->pages += (pages - loc->pages) / loc->samples;
+    loc->line_density += 
+	(live / (lines * CACHE_LINE) - loc->line_density) / loc->samples;
+    loc->page_density += 
+	(live / (pages * page) - loc->page_density) / loc->samples;
+}
+
+/*
+ * eval_locality - Replay the trace once more, recording how far each
+ *    block lies from the one allocated before it, and, at
+ *    LOCALITY_SAMPLES points, how densely the live blocks fill the 
+ *    cache lines and pages they lie on. A package that packs blocks
+ *    that are allocated together, and live ones together, needs fewer
+ *    cache lines and TLB entries for the same data.
+ */
+static void eval_locality(backend_t *b, trace_t *trace, locality_t *loc)
+{
+    int i, bucket;
+    int index, every;
+    char *p = NULL, *prev = NULL;
+    size_t dist, *blocks;
+
+    memset(loc, 0, sizeof(*loc));
+    every = trace->num_ops / LOCALITY_SAMPLES;
+    if (every < 1)
+	every = 1;
+    if ((blocks = malloc((2 * trace->num_ids + 1) * sizeof(size_t))) == NULL)
+	unix_error("malloc failed in eval_locality");
+    for (i = 0; i < trace->num_ids; i++)
+	trace->blocks[i] = NULL;
+
+    if (b->uses_memlib)
+	mem_reset_brk();
+    if (init_backend(b, trace) < 0)
+	app_error("mm_init failed in eval_locality");
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* mm_malloc */
+	    if ((p = b->malloc(trace->ops[i].size)) == NULL) 
+		app_error("mm_malloc failed in eval_locality");
+	    break;
+
+	case REALLOC: /* mm_realloc */
+	    if ((p = b->realloc(trace->blocks[index], trace->ops[i].size)) 
+		== NULL)
+		app_error("mm_realloc failed in eval_locality");
+	    break;
+
+        case FREE: /* mm_free */
+	    b->free(trace->blocks[index]);
+	    trace->blocks[index] = NULL;
+	    p = NULL;
 	    break;
 
 	default:
-	    app_error("invalid operation type  in eval_libc_valid");
+	    app_error("Nonexistent request type in eval_locality");
+        }
+
+	if (p != NULL) {
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = trace->ops[i].size;
+	    if (prev != NULL) {
+		dist = p > prev ? p - prev : prev - p;
+		for (bucket = 0; bucket < LOCALITY_BUCKETS - 1 && dist >= 2; 
+		     bucket++)
+		    dist /= 2;
+		loc->dist[bucket]++;
+	    }
+	    prev = p;
 	}
+	if ((i + 1) % every == 0)
+	    sample_locality(trace, blocks, loc);
     }
+    free(blocks);
+}
 
-    return 1;
+/*
+ * process_rss - bytes of physical memory the whole process uses
+ */
+static double process_rss(void)
+{
+    FILE *fp;
+    unsigned long size, resident = 0;
+
+    if ((fp = fopen("/proc/self/statm", "r")) == NULL)
+	return 0;
+    if (fscanf(fp, "%lu %lu", &size, &resident) != 2)
+	resident = 0;
+    fclose(fp);
+    return (double)resident * mem_pagesize();
 }
 
-/* 
- * eval_libc_speed - This is the function that is used by fcyc() to
- *    measure the running time of the libc malloc package on the set
- *    of traces.
+/*
+ * touch_pages - write to every page of the size bytes at p
  */
-static void eval_libc_speed(void *ptr)
+static void touch_pages(char *p, size_t size)
 {
-    int i;
-    int index, size, newsize;
-    char *p, *newp, *oldp, *block;
-    trace_t *trace = ((speed_t *)ptr)->trace;
+    char *end = p + size;
+    size_t page = mem_pagesize();
+
+    for (; p < end; p = (char *)(((size_t)p + page) & ~(page - 1)))
+	*p = 0;
+}
+
+/*
+ * eval_footprint - Replay the trace once more, writing to every page of
+ *    each block as a program would, and read how much physical memory
+ *    the package uses at FOOTPRINT_SAMPLES points and at the end. For
+ *    packages whose heap comes from memlib, that is the pages of the
+ *    heap in memory, which are given back first. For the others, it is
+ *    how much the RSS of the process grew. Runs in a child of the 
+ *    footprint server (see start_footprint), whose libc heap no 
+ *    package has used yet.
+ */
+static void eval_footprint(backend_t *b, trace_t *trace, footprint_t *fp)
+{
+    int i, index, size, every;
+    double live = 0, base = 0, rss;
+    char *p;
+
+    every = trace->num_ops / FOOTPRINT_SAMPLES;
+    if (every < 1)
+	every = 1;
+    fp->live_peak = fp->rss_peak = fp->rss_end = 0;
+
+    /* Fault in mdriver's own arrays, which must not count */
+    memset(trace->blocks, 0, trace->num_ids * sizeof(char *));
+    memset(trace->block_sizes, 0, trace->num_ids * sizeof(size_t));
+
+    if (b->uses_memlib) {
+	mem_discard();
+	mem_reset_brk();
+    }
+    else
+	base = process_rss();
+    if (init_backend(b, trace) < 0)
+	app_error("mm_init failed in eval_footprint");
 
     for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+	size = trace->ops[i].size;
         switch (trace->ops[i].type) {
-        case ALLOC: /* malloc */
-	    index = trace->ops[i].index;
-	    size = trace->ops[i].size;
-	    if ((p = malloc(size)) == NULL)
-		unix_error("malloc failed in eval_libc_speed");
+
+        case ALLOC: /* mm_malloc */
+	    if ((p = b->malloc(size)) == NULL) 
+		app_error("mm_malloc failed in eval_footprint");
+	    touch_pages(p, size);
 	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    live += size;
 	    break;
 
-	case REALLOC: /* realloc */
-	    index = trace->ops[i].index;
-	    newsize = trace->ops[i].size;
-	    oldp = trace->blocks[index];
-	    if ((newp = realloc(oldp, newsize)) == NULL)
-		unix_error("realloc failed in eval_libc_speed\n");
-	    
-	    trace->blocks[index] = newp;
+	case REALLOC: /* mm_realloc */
+	    if ((p = b->realloc(trace->blocks[index], size)) == NULL)
+		app_error("mm_realloc failed in eval_footprint");
+	    touch_pages(p, size);
+	    live += size - (double)trace->block_sizes[index];
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
 	    break;
-	    
-        case FREE: /* free */
-	    index = trace->ops[i].index;
-	    block = trace->blocks[index];
-	    free(block);
+
+        case FREE: /* mm_free */
+	    b->free(trace->blocks[index]);
+	    live -= trace->block_sizes[index];
 	    break;
+
+	default:
+	    app_error("Nonexistent request type in eval_footprint");
+        }
+
+	if (live > fp->live_peak)
+	    fp->live_peak = live;
+	if ((i + 1) % every == 0 || i == trace->num_ops - 1) {
+	    rss = b->uses_memlib ? mem_resident() : process_rss() - base;
+	    if (rss > fp->rss_peak)
+		fp->rss_peak = rss;
+	    fp->rss_end = rss > 0 ? rss : 0;
+	}
+    }
+}
+
+/* A request to the footprint server */
+typedef struct {
+    backend_t *b;
+    int tracenum;
+} footprint_req_t;
+
+static int footprint_fds[2] = {-1, -1}; /* to and from the server */
+
+/*
+ * start_footprint - fork the footprint server, before any package has
+ *     run. For each request it forks a child that reads the trace and
+ *     runs eval_footprint, so that no pass starts with memory that an
+ *     earlier one left behind (libc keeps freed memory, and would hand
+ *     it out again without new pages being touched).
+ */
+static void start_footprint(char **tracefiles)
+{
+    int req[2], res[2], status;
+    footprint_req_t rq;
+    footprint_t fp;
+    trace_t *trace;
+    pid_t pid;
+
+    if (pipe(req) < 0 || pipe(res) < 0)
+	unix_error("pipe failed in start_footprint");
+    fflush(stdout);
+    if ((pid = fork()) < 0)
+	unix_error("fork failed in start_footprint");
+    if (pid > 0) {
+	close(req[0]);
+	close(res[1]);
+	footprint_fds[0] = req[1];
+	footprint_fds[1] = res[0];
+	return;
+    }
+
+    close(req[1]);
+    close(res[0]);
+    while (read(req[0], &rq, sizeof(rq)) == sizeof(rq)) {
+	if ((pid = fork()) == 0) {
+	    trace = read_trace(tracedir, tracefiles[rq.tracenum]);
+	    eval_footprint(rq.b, trace, &fp);
+	    if (write(res[1], &fp, sizeof(fp)) != sizeof(fp))
+		_exit(1);
+	    _exit(0);
+	}
+	if (pid < 0 || waitpid(pid, &status, 0) < 0 || 
+	    !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+	    fp.live_peak = fp.rss_peak = fp.rss_end = -1;
+	    if (write(res[1], &fp, sizeof(fp)) != sizeof(fp))
+		_exit(1);
+	}
+    }
+    _exit(0);
+}
+
+/*
+ * run_footprint - have the footprint server measure a trace
+ */
+static void run_footprint(backend_t *b, int tracenum, footprint_t *fp)
+{
+    footprint_req_t rq;
+
+    rq.b = b;
+    rq.tracenum = tracenum;
+    if (write(footprint_fds[0], &rq, sizeof(rq)) != sizeof(rq) ||
+	read(footprint_fds[1], fp, sizeof(*fp)) != sizeof(*fp))
+	unix_error("the footprint server is gone");
+}
+
+/*
+ * eval_space - the correctness and space utilization passes over one
+ *     trace, filling in everything in *stats except the timings
+ */
+static void eval_space(backend_t *b, trace_t *trace, int tracenum, 
+		       range_t **ranges, stats_t *stats)
+{
+    stats->ops = trace->num_ops;
+    if (verbose > 1)
+	printf("Checking %s malloc for correctness%s\n", b->name, 
+	       b->uses_memlib ? " and efficiency" : "");
+    stats->valid = eval_valid(b, trace, tracenum, ranges);
+    if (stats->valid && b->uses_memlib) {
+	stats->util = eval_util(b, trace, &stats->peak);
+	stats->heapsize = mem_heapsize();
+	if (b->stats)
+	    b->stats(&stats->end);
+    }
+}
+
+/* What a -j worker sends back for its trace */
+typedef struct {
+    int tracenum;
+    int errors;      /* errors it reported */
+    stats_t stats;
+} job_result_t;
+
+/*
+ * eval_parallel - run eval_space (and eval_speed, if speed is set) over
+ *     the n traces in up to jobs worker processes at once, one process
+ *     per trace. Each has its own copy of memlib's heap, so they can't
+ *     get in each other's way. They send their results back over a pipe,
+ *     in one write of less than PIPE_BUF bytes, which can't be interleaved
+ *     with another worker's. A worker that dies fails its trace.
+ */
+static void eval_parallel(backend_t *b, char **tracefiles, int n, 
+			  stats_t *stats, int jobs, int speed)
+{
+    int fds[2];
+    int next = 0, running = 0;
+    int i, status;
+    pid_t pid, *pids;
+    job_result_t res;
+    trace_t *trace;
+    range_t *ranges = NULL;
+    speed_t params;
+
+    if (pipe(fds) < 0)
+	unix_error("pipe failed in eval_parallel");
+    if ((pids = calloc(n, sizeof(pid_t))) == NULL)
+	unix_error("calloc failed in eval_parallel");
+
+    while (next < n || running > 0) {
+	/* Start another worker if there is room */
+	if (next < n && running < jobs) {
+	    fflush(stdout);
+	    if ((pid = fork()) < 0)
+		unix_error("fork failed in eval_parallel");
+	    if (pid == 0) {
+		/* Spread the workers over every CPU, not just the pinned one */
+		if (pinned)
+		    sched_setaffinity(0, sizeof(all_cpus), &all_cpus);
+		close(fds[0]);
+		memset(&res, 0, sizeof(res));
+		res.tracenum = next;
+		res.errors = errors;
+		trace = read_trace(tracedir, tracefiles[next]);
+		eval_space(b, trace, next, &ranges, &res.stats);
+		if (speed && res.stats.valid) {
+		    params.backend = b;
+		    params.trace = trace;
+		    params.ranges = ranges;
+		    params.touch = touch_pct;
+		    time_trace(eval_speed, &params, &res.stats);
+		}
+		res.errors = errors - res.errors;
+		if (write(fds[1], &res, sizeof(res)) != sizeof(res))
+		    exit(1);
+		fflush(stdout);
+		_exit(0);
+	    }
+	    pids[next++] = pid;
+	    running++;
+	    continue;
+	}
+
+	/* Otherwise wait for one to finish */
+	if ((pid = wait(&status)) < 0)
+	    unix_error("wait failed in eval_parallel");
+	for (i = 0; i < n && pids[i] != pid; i++)
+	    ;
+	if (i == n)
+	    continue; /* not one of ours, e.g. the --footprint server */
+	pids[i] = 0; /* in case a later worker gets the same pid */
+	running--;
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+	    if (read(fds[0], &res, sizeof(res)) != sizeof(res))
+		unix_error("read failed in eval_parallel");
+	    stats[res.tracenum] = res.stats;
+	    errors += res.errors;
+	}
+	else {
+	    stats[i].ops = 0;
+	    stats[i].valid = 0;
+	    malloc_error(i, 0, WIFSIGNALED(status) ? 
+			 "the worker for this trace was killed by a signal" :
+			 "the worker for this trace failed");
 	}
     }
+    close(fds[0]);
+    close(fds[1]);
+    free(pids);
 }
 
 /*************************************
@@ -919,33 +1609,403 @@ static void eval_libc_speed(void *ptr)
  ************************************/
 
 
+/*
+ * time_trace - time one speed function with fsecs, --runs times, and
+ *     set stats->secs to the median run. With one run, secs_ci is the
+ *     half-width of fsecs' own 95% confidence interval (0 for timing
+ *     methods that take a single sample); with more, it is that of the
+ *     mean of the runs, and secs_cv their coefficient of variation.
+ *     With --calibrate, the trace is first timed on the null package,
+ *     which leaves only the cost of the loop in f, in stats->overhead.
+ *     With --touch, one more run counts the cache misses.
+ */
+static void time_trace(fsecs_test_funct f, speed_t *params, stats_t *stats)
+{
+    double *secs;
+    double sum = 0, var = 0, mean, stddev, t;
+    fsecs_stats_t st;
+    speed_t null_params;
+    int i, j;
+
+    /* Take the heap's page faults now rather than in the first timed
+       run. This is done here, in the process that times, since a fork
+       (-j workers, the --footprint server) leaves the pages copy-on-write
+       in both processes. */
+    mem_prefault();
+
+    if (calibrate) {
+	null_params = *params;
+	null_params.backend = &null_backend;
+	null_params.touch = 0;   /* its one block is shared by all */
+	stats->overhead = fsecs(f, &null_params);
+    }
+
+    if ((secs = malloc(runs * sizeof(double))) == NULL)
+	unix_error("malloc failed in time_trace");
+    for (i = 0; i < runs; i++) {
+	secs[i] = fsecs(f, params);
+	fsecs_stats(&st);
+	if (verbose > 1 && st.samples > 1)
+	    printf("%d samples, best %.6f, mean %.6f +/- %.6f secs\n",
+		   st.samples, secs[i], st.mean, st.ci);
+	sum += secs[i];
+    }
+
+    for (j = 0; j < NUM_PERFCTRS; j++)
+	stats->misses[j] = -1;
+    if (touch_pct >= 0 && perfctr_count(f, params, stats->misses) == 0 &&
+	verbose > 1)
+	printf("No cache miss counters here\n");
+
+    if (runs == 1) {
+	stats->secs = secs[0];
+	stats->secs_ci = st.ci;
+	stats->secs_cv = 0.0;
+	free(secs);
+	return;
+    }
+
+    /* Insertion sort; there are only a handful of runs */
+    for (i = 1; i < runs; i++) {
+	t = secs[i];
+	for (j = i; j > 0 && secs[j-1] > t; j--)
+	    secs[j] = secs[j-1];
+	secs[j] = t;
+    }
+    mean = sum / runs;
+    for (i = 0; i < runs; i++)
+	var += (secs[i] - mean) * (secs[i] - mean);
+    stddev = sqrt(var / (runs - 1));
+    stats->secs = (runs % 2) ? secs[runs/2] : 
+	(secs[runs/2 - 1] + secs[runs/2]) / 2;
+    stats->secs_ci = 1.96 * stddev / sqrt(runs);
+    stats->secs_cv = stddev / mean;
+    if (verbose > 1)
+	printf("%d runs, median %.6f, mean %.6f, cv %.2f%%\n",
+	       runs, stats->secs, mean, 100.0 * stats->secs_cv);
+    free(secs);
+}
+
+/*
+ * isolate - pin the driver to cpu (unless it is -1) and, if prio is
+ *     set, ask for the highest scheduling priority. Not being allowed a
+ *     higher priority only earns a warning. The CPUs we had before are
+ *     kept in all_cpus, so that the -j workers can spread out again.
+ */
+static void isolate(int cpu, int prio)
+{
+    cpu_set_t set;
+
+    if (cpu >= 0) {
+	if (cpu >= CPU_SETSIZE) {
+	    fprintf(stderr, "ERROR: no CPU %d\n", cpu);
+	    exit(1);
+	}
+	if (sched_getaffinity(0, sizeof(all_cpus), &all_cpus) < 0)
+	    unix_error("sched_getaffinity failed in isolate");
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	pinned = 1;
+	if (sched_setaffinity(0, sizeof(set), &set) < 0)
+	    unix_error("sched_setaffinity failed in isolate");
+    }
+    if (prio && setpriority(PRIO_PROCESS, 0, -20) < 0)
+	fprintf(stderr, "Warning: can't raise the priority (%s)\n", 
+		strerror(errno));
+}
+
+/*
+ * printbreakdown - prints, for each valid trace, where the heap bytes 
+ *    were at the point of peak payload, as percentages of the heap 
+ *    size at that point
+ */
+static void printbreakdown(int n, stats_t *stats)
+{
+    int i;
+    double heap;
+    mm_stats_t *p;
+
+    printf("Heap breakdown at peak payload:\n");
+    printf("%5s%9s%7s%7s%7s%7s%9s%9s\n", "trace", "payload", "tags", 
+	   "pad", "slack", "free", "stranded", "heap");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid)
+	    continue;
+	p = &stats[i].peak;
+	heap = p->payload_bytes + p->tag_bytes + p->pad_bytes + 
+	    p->slack_bytes + p->stranded_bytes + p->free_bytes;
+	if (heap == 0)
+	    continue;
+	printf("%2d%11.1f%%%6.1f%%%6.1f%%%6.1f%%%6.1f%%%8.1f%%%9.0f\n", i,
+	       100.0*p->payload_bytes/heap, 100.0*p->tag_bytes/heap,
+	       100.0*p->pad_bytes/heap, 100.0*p->slack_bytes/heap,
+	       100.0*p->free_bytes/heap, 100.0*p->stranded_bytes/heap, heap);
+    }
+}
+
+/*
+ * printcounters - prints the allocator's call counters for each valid 
+ *    trace (as of the end of the util pass), the nonzero buckets of its
+ *    free-list probe histogram, and its live/free blocks per size class 
+ *    at the point of peak payload
+ */
+static void printcounters(int n, stats_t *stats)
+{
+    int i, j;
+    mm_stats_t *e, *p;
+
+    printf("Allocator counters:\n");
+    printf("%5s%9s%9s%9s%9s%9s%9s%11s\n", "trace", "malloc", "free", 
+	   "realloc", "inplace", "copy", "extends", "ext bytes");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid)
+	    continue;
+	e = &stats[i].end;
+	printf("%2d%12u%9u%9u%9u%9u%9u%11u\n", i, 
+	       (unsigned) e->malloc_calls, (unsigned) e->free_calls,
+	       (unsigned) e->realloc_calls, (unsigned) e->realloc_inplace, 
+	       (unsigned) e->realloc_copy, (unsigned) e->extend_calls, 
+	       (unsigned) e->extend_bytes);
+    }
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid)
+	    continue;
+	e = &stats[i].end;
+	p = &stats[i].peak;
+	printf("%2d probes:", i);
+	for (j=0; j < MM_PROBE_BUCKETS; j++)
+	    if (e->probes[j]) {
+		if (j == 0)
+		    printf(" 1");
+		else if (j == MM_PROBE_BUCKETS-1)
+		    printf(" %u+", 1u << j);
+		else
+		    printf(" %u-%u", 1u << j, (2u << j) - 1);
+		printf(":%u", (unsigned) e->probes[j]);
+	    }
+	printf("\n   classes (live/free at peak):");
+	for (j=0; j < MM_SIZE_CLASSES; j++)
+	    if (p->live_by_class[j] || p->free_by_class[j])
+		printf(" %u%s:%u/%u", 16u << j, 
+		       j == MM_SIZE_CLASSES-1 ? "+" : "",
+		       (unsigned) p->live_by_class[j], 
+		       (unsigned) p->free_by_class[j]);
+	printf("\n");
+    }
+}
+
+/*
+ * printmisses - prints, for each valid trace, the cache and TLB misses
+ *    per request in one run with --touch
+ */
+static void printmisses(int n, stats_t *stats)
+{
+    int i, j;
+
+    printf("Misses per request, payloads touched %d%%:\n", touch_pct);
+    printf("%5s", "trace");
+    for (j = 0; j < NUM_PERFCTRS; j++)
+	printf("%9s", perfctr_names[j]);
+    printf("\n");
+    for (i = 0; i < n; i++) {
+	if (!stats[i].valid)
+	    continue;
+	printf("%2d   ", i);
+	for (j = 0; j < NUM_PERFCTRS; j++)
+	    if (stats[i].misses[j] >= 0)
+		printf("%9.3f", stats[i].misses[j] / stats[i].ops);
+	    else
+		printf("%9s", "-");
+	printf("\n");
+    }
+}
+
+/*
+ * printthreads - prints the throughput of the multithreaded replay of
+ *     each trace, and the latency of the calls made by each thread
+ */
+static void printthreads(int n, stats_t *stats, char **tracefiles)
+{
+    int i, t;
+    thread_stats_t *th;
+
+    printf("%5s%8s%9s%10s%8s  %s\n", 
+	   "trace", "threads", "ops", "secs", "Kops", "name");
+    for (i = 0; i < n; i++) {
+	if (!stats[i].valid) {
+	    printf("%2d%11s%9s%10s%8s  %s\n", i, "-", "-", "-", "-", 
+		   tracefiles[i]);
+	    continue;
+	}
+	printf("%2d%11d%9.0f%10.6f%8.0f  %s\n", i, stats[i].mt.num_threads,
+	       stats[i].ops, stats[i].mt.secs, 
+	       (stats[i].ops/1e3)/stats[i].mt.secs, tracefiles[i]);
+	printf("%13s%9s%10s%10s%10s%10s  (usecs per call)\n", 
+	       "thread", "ops", "avg", "p50", "p99", "max");
+	for (t = 0; t < stats[i].mt.num_threads; t++) {
+	    th = &stats[i].mt.threads[t];
+	    if (th->ops == 0)
+		continue;
+	    printf("%13d%9d%10.3f%10.3f%10.3f%10.1f\n", t, th->ops, 
+		   th->secs*1e6/th->ops, latency_quantile(th, 0.5),
+		   latency_quantile(th, 0.99), th->max_usecs);
+	}
+    }
+}
+
+/*
+ * printlocality - prints, for each valid trace, the share of blocks
+ *     allocated within a cache line and within a page of the block 
+ *     allocated before them, the median distance between the two, and
+ *     how densely the live blocks fill their cache lines and pages
+ */
+static void printlocality(int n, stats_t *stats)
+{
+    int i, j;
+    double total, in_line, in_page, seen;
+    size_t page = mem_pagesize();
+    locality_t *loc;
+
+    printf("%5s%8s%8s%10s%10s%10s%8s%8s\n", "trace", "<line", "<page",
+	   "median", "lines", "pages", "line", "page");
+    for (i = 0; i < n; i++) {
+	loc = &stats[i].loc;
+	if (!stats[i].valid || loc->samples == 0) {
+	    printf("%2d%11s%8s%10s%10s%10s%8s%8s\n", i, 
+		   "-", "-", "-", "-", "-", "-", "-");
+	    continue;
+	}
+
+	/* Bucket j holds distances below 2^(j+1) */
+	total = in_line = in_page = 0;
+	for (j = 0; j < LOCALITY_BUCKETS; j++) {
+	    total += loc->dist[j];
+	    if ((2u << j) <= CACHE_LINE)
+		in_line += loc->dist[j];
+	    if ((2u << j) <= page)
+		in_page += loc->dist[j];
+	}
+	for (j = 0, seen = 0; j < LOCALITY_BUCKETS - 1; j++)
+	    if ((seen += loc->dist[j]) >= total / 2)
+		break;
+
+	printf("%2d%10.1f%%%7.1f%%%10.0f%10.0f%10.0f%7.1f%%%7.1f%%\n", i, 
+	       total ? 100.0 * in_line / total : 0.0,
+	       total ? 100.0 * in_page / total : 0.0,
+	       (double)(2u << j), loc->lines, loc->pages, 
+	       100.0 * loc->line_density, 100.0 * loc->page_density);
+	if (verbose > 1) {
+	    printf("   distances:");
+	    for (j = 0; j < LOCALITY_BUCKETS; j++)
+		if (loc->dist[j])
+		    printf(" <%.0f:%u", (double)(2u << j), loc->dist[j]);
+	    printf("\n");
+	}
+    }
+    printf("(<line, <page: allocations within a cache line or a page of "
+	   "the one before;\n median: distance below which half of them "
+	   "were; lines, pages: mean\n number the live blocks lie on; "
+	   "line, page: how full those are)\n");
+}
+
+/*
+ * printfootprint - prints, for each valid trace, the peak payload, the
+ *     peak and final physical memory used, and the utilization of the
+ *     physical memory at its peak
+ */
+static void printfootprint(int n, stats_t *stats)
+{
+    int i;
+
+    printf("%5s%11s%11s%11s%9s\n", "trace", "peak live", "peak RSS", 
+	   "end RSS", "util");
+    for (i = 0; i < n; i++) {
+	if (!stats[i].valid || stats[i].fp.rss_peak <= 0) {
+	    printf("%2d%14s%11s%11s%9s\n", i, "-", "-", "-", "-");
+	    continue;
+	}
+	printf("%2d%13.0fK%10.0fK%10.0fK%8.0f%%\n", i, 
+	       stats[i].fp.live_peak/1024, stats[i].fp.rss_peak/1024, 
+	       stats[i].fp.rss_end/1024, 
+	       100.0 * stats[i].fp.live_peak / stats[i].fp.rss_peak);
+    }
+}
+
+/*
+ * print_net_kops - print the throughput of a package once the time 
+ *     mdriver took itself is taken out, or "-" if noise ate all of it
+ */
+static void print_net_kops(double ops, double secs, double overhead)
+{
+    if (secs > overhead)
+	printf("%9.0f", (ops/1e3)/(secs - overhead));
+    else
+	printf("%9s", "-");
+}
+
 /*
  * printresults - prints a performance summary for some malloc package
  */
 static void printresults(int n, stats_t *stats) 
 {
     int i;
+    int show_ci = 0;
+    int show_cv = 0;
+    int show_net = 0;
     double secs = 0;
+    double overhead = 0;
     double ops = 0;
     double util = 0;
+    int all_valid = 1;
+
+    /* Only timing methods that take several samples have an interval */
+    for (i=0; i < n; i++)
+	if (stats[i].valid && stats[i].secs_ci > 0)
+	    show_ci = 1;
+    /* ... and only --runs gives a run-to-run spread */
+    for (i=0; i < n; i++)
+	if (stats[i].valid && stats[i].secs_cv > 0)
+	    show_cv = 1;
+    /* ... and --calibrate the share of mdriver's own loop */
+    for (i=0; i < n; i++)
+	if (stats[i].valid && stats[i].overhead > 0)
+	    show_net = 1;
 
     /* Print the individual results for each trace */
-    printf("%5s%7s %5s%8s%10s%6s\n", 
+    printf("%5s%7s %5s%8s%10s%6s", 
 	   "trace", " valid", "util", "ops", "secs", "Kops");
+    if (show_ci)
+	printf("%8s", "+/-");
+    if (show_cv)
+	printf("%7s", "cv");
+    if (show_net)
+	printf("%6s%9s", "ovhd", "net Kops");
+    printf("\n");
     for (i=0; i < n; i++) {
 	if (stats[i].valid) {
-	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f\n", 
+	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f", 
 		   i,
 		   "yes",
 		   stats[i].util*100.0,
 		   stats[i].ops,
 		   stats[i].secs,
 		   (stats[i].ops/1e3)/stats[i].secs);
+	    if (show_ci)
+		printf("%7.1f%%", 100.0*stats[i].secs_ci/stats[i].secs);
+	    if (show_cv)
+		printf("%6.1f%%", 100.0*stats[i].secs_cv);
+	    if (show_net) {
+		printf("%5.0f%%", 100.0*stats[i].overhead/stats[i].secs);
+		print_net_kops(stats[i].ops, stats[i].secs, stats[i].overhead);
+	    }
+	    printf("\n");
 	    secs += stats[i].secs;
+	    overhead += stats[i].overhead;
 	    ops += stats[i].ops;
 	    util += stats[i].util;
 	}
 	else {
+	    all_valid = 0;
 	    printf("%2d%10s%6s%8s%10s%6s\n", 
 		   i,
 		   "no",
@@ -957,13 +2017,19 @@ static void printresults(int n, stats_t *stats)
     }
 
     /* Print the aggregate results for the set of traces */
-    if (errors == 0) {
-	printf("%12s%5.0f%%%8.0f%10.6f%6.0f\n", 
+    if (all_valid) {
+	printf("%12s%5.0f%%%8.0f%10.6f%6.0f", 
 	       "Total       ",
 	       (util/n)*100.0,
 	       ops, 
 	       secs,
 	       (ops/1e3)/secs);
+	if (show_net) {
+	    printf("%*s%5.0f%%", (show_ci ? 8 : 0) + (show_cv ? 7 : 0), "",
+		   100.0*overhead/secs);
+	    print_net_kops(ops, secs, overhead);
+	}
+	printf("\n");
     }
     else {
 	printf("%12s%6s%8s%10s%6s\n", 
@@ -976,6 +2042,324 @@ static void printresults(int n, stats_t *stats)
 
 }
 
+/*
+ * printcomparison - prints the totals of several malloc packages side
+ *     by side, one line each; "extends" is how many times the packages
+ *     with mm_stats grew their heaps in the util passes
+ */
+static void printcomparison(backend_t **selected, stats_t **results, 
+			    int num_backends, int n)
+{
+    int i, k, valid;
+    int show_rss = 0;
+    double secs, ops, util, rss_util, extends;
+
+    /* With --footprint, libc gets a utilization too, of physical memory */
+    for (k = 0; k < num_backends; k++)
+	for (i = 0; i < n; i++)
+	    if (results[k][i].valid && results[k][i].fp.rss_peak > 0)
+		show_rss = 1;
+
+    printf("%-20s%8s%6s%9s%10s%8s%9s", 
+	   "allocator", "valid", "util", "ops", "secs", "Kops", "extends");
+    printf(show_rss ? "%9s\n" : "\n", "RSS util");
+    for (k = 0; k < num_backends; k++) {
+	valid = 0;
+	secs = ops = util = rss_util = extends = 0;
+	for (i = 0; i < n; i++) {
+	    if (results[k][i].valid) {
+		valid++;
+		secs += results[k][i].secs;
+		ops += results[k][i].ops;
+		util += results[k][i].util;
+		extends += results[k][i].end.extend_calls;
+		if (results[k][i].fp.rss_peak > 0)
+		    rss_util += results[k][i].fp.live_peak / 
+			results[k][i].fp.rss_peak;
+	    }
+	}
+	printf("%-20s%5d/%-2d", selected[k]->name, valid, n);
+	if (valid == 0)
+	    printf("%6s%9s%10s%8s", "-", "-", "-", "-");
+	else if (selected[k]->uses_memlib)
+	    printf("%5.0f%%%9.0f%10.6f%8.0f", (util/valid)*100.0, 
+		   ops, secs, (ops/1e3)/secs);
+	else
+	    printf("%6s%9.0f%10.6f%8.0f", "-", ops, secs, (ops/1e3)/secs);
+	if (valid > 0 && selected[k]->stats)
+	    printf("%9.0f", extends);
+	else
+	    printf("%9s", "-");
+	if (show_rss && valid > 0)
+	    printf("%8.0f%%", (rss_util/valid)*100.0);
+	printf("\n");
+    }
+}
+
+/*
+ * select_backends - parse the comma-separated list of mdriver -A
+ */
+static void select_backends(char *list, backend_t **selected, 
+			    int *num_backends)
+{
+    char *name;
+    backend_t *b;
+    int i;
+
+    *num_backends = 0;
+    for (name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+	if ((b = find_backend(name)) == NULL) {
+	    fprintf(stderr, "Unknown allocator %s. Available allocators:\n", 
+		    name);
+	    for (i = 0; backends[i] != NULL; i++)
+		fprintf(stderr, "\t%-20s %s\n", backends[i]->name, 
+			backends[i]->description);
+	    exit(1);
+	}
+	if (*num_backends == MAXBACKENDS) {
+	    fprintf(stderr, "At most %d allocators can be compared\n", 
+		    MAXBACKENDS);
+	    exit(1);
+	}
+	selected[(*num_backends)++] = b;
+    }
+}
+
+/*****************************************************************
+ * The following routines write the per-trace results in a form
+ * that scripts can consume, and compare a run against a saved one.
+ ****************************************************************/
+
+/*
+ * open_output - open a results file for writing, "-" being stdout
+ */
+static FILE *open_output(char *path)
+{
+    FILE *fp;
+
+    if (!strcmp(path, "-"))
+	return stdout;
+    if ((fp = fopen(path, "w")) == NULL) {
+	sprintf(msg, "Could not open %s for writing", path);
+	unix_error(msg);
+    }
+    return fp;
+}
+
+/*
+ * write_csv_rows - one CSV line per trace of one allocator 
+ */
+static void write_csv_rows(FILE *fp, char *allocator, char **tracefiles,
+			   int n, stats_t *stats)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+	fprintf(fp, "%s,%s,%d,%.0f,%.9f,%.9f,%.6f,%.9f,%.0f,%.0f,%.0f,"
+		"%.3f,%.6f,%.0f,%.0f,%.0f\n",
+		allocator, tracefiles[i], stats[i].valid, stats[i].ops,
+		stats[i].secs, stats[i].secs_ci, stats[i].secs_cv,
+		stats[i].overhead, stats[i].misses[PERFCTR_L1D],
+		stats[i].misses[PERFCTR_LLC], stats[i].misses[PERFCTR_DTLB],
+		stats[i].valid ? (stats[i].ops/1e3)/stats[i].secs : 0.0,
+		stats[i].util, stats[i].heapsize, stats[i].fp.rss_peak,
+		stats[i].fp.rss_end);
+    }
+}
+
+/*
+ * write_json_string - write s as a JSON string literal, escaping quotes,
+ *     backslashes and control characters
+ */
+static void write_json_string(FILE *fp, char *s)
+{
+    unsigned char c;
+
+    putc('"', fp);
+    for (; (c = *s) != '\0'; s++) {
+	if (c == '"' || c == '\\')
+	    fprintf(fp, "\\%c", c);
+	else if (c < 0x20)
+	    fprintf(fp, "\\u%04x", c);
+	else
+	    putc(c, fp);
+    }
+    putc('"', fp);
+}
+
+/*
+ * write_json_rows - one JSON object per trace of one allocator 
+ */
+static void write_json_rows(FILE *fp, char *allocator, char **tracefiles,
+			    int n, stats_t *stats, int more)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+	fprintf(fp, "    {\"allocator\": ");
+	write_json_string(fp, allocator);
+	fprintf(fp, ", \"trace\": ");
+	write_json_string(fp, tracefiles[i]);
+	fprintf(fp, ", "
+		"\"valid\": %d, \"ops\": %.0f, \"secs\": %.9f, "
+		"\"secs_ci\": %.9f, \"secs_cv\": %.6f, "
+		"\"overhead_secs\": %.9f, \"l1d_misses\": %.0f, "
+		"\"llc_misses\": %.0f, \"dtlb_misses\": %.0f, \"kops\": %.3f, "
+		"\"util\": %.6f, \"heapsize\": %.0f, \"rss_peak\": %.0f, "
+		"\"rss_end\": %.0f}%s\n",
+		stats[i].valid, stats[i].ops,
+		stats[i].secs, stats[i].secs_ci, stats[i].secs_cv,
+		stats[i].overhead, stats[i].misses[PERFCTR_L1D],
+		stats[i].misses[PERFCTR_LLC], stats[i].misses[PERFCTR_DTLB],
+		stats[i].valid ? (stats[i].ops/1e3)/stats[i].secs : 0.0,
+		stats[i].util, stats[i].heapsize, stats[i].fp.rss_peak,
+		stats[i].fp.rss_end,
+		(more || i < n-1) ? "," : "");
+    }
+}
+
+/*
+ * write_results - write the per-trace results of each selected package
+ *     to path, as CSV or as JSON
+ */
+static void write_results(char *path, int json, char **tracefiles, int n,
+			  backend_t **selected, stats_t **results, 
+			  int num_backends, double perfindex)
+{
+    FILE *fp = open_output(path);
+    int k;
+
+    if (json) {
+	fprintf(fp, "{\n  \"perfidx\": %.1f,\n  \"errors\": %d,\n", 
+		perfindex, errors);
+	fprintf(fp, "  \"results\": [\n");
+	for (k = 0; k < num_backends; k++)
+	    write_json_rows(fp, selected[k]->name, tracefiles, n, results[k], 
+			    k < num_backends - 1);
+	fprintf(fp, "  ]\n}\n");
+    }
+    else {
+	fprintf(fp, "allocator,trace,valid,ops,secs,secs_ci,secs_cv,"
+		"overhead_secs,l1d_misses,llc_misses,dtlb_misses,kops,util,"
+		"heapsize,rss_peak,rss_end\n");
+	for (k = 0; k < num_backends; k++)
+	    write_csv_rows(fp, selected[k]->name, tracefiles, n, results[k]);
+    }
+
+    if (fp != stdout)
+	fclose(fp);
+    else
+	fflush(fp);
+}
+
+/*
+ * split_csv - split a CSV line in place, returning the number of fields
+ */
+static int split_csv(char *line, char **fields)
+{
+    int n = 0;
+    char *p = line;
+
+    line[strcspn(line, "\r\n")] = '\0';
+    while (n < MAXFIELDS) {
+	fields[n++] = p;
+	if ((p = strchr(p, ',')) == NULL)
+	    break;
+	*p++ = '\0';
+    }
+    return n;
+}
+
+/*
+ * compare_baseline - compare the results of one allocator against the
+ *     same allocator's lines in a CSV file written by an earlier --csv
+ *     run, and report every trace that regressed. Throughput counts as
+ *     regressed when it dropped by more than tol percent *and* by more
+ *     than the combined 95% confidence intervals of the two runs (if
+ *     the timing method provides them). Utilization is deterministic,
+ *     so any drop of more than UTIL_TOL points counts. Returns the
+ *     number of regressions found.
+ */
+static int compare_baseline(char *path, char **tracefiles, int n,
+			    char *allocator, stats_t *stats, double tol)
+{
+    FILE *fp;
+    char line[MAXLINE];
+    char *fields[MAXFIELDS];
+    int nfields, i, regressions = 0, matched = 0;
+    int col_alloc = -1, col_trace = -1, col_valid = -1, col_secs = -1;
+    int col_ci = -1, col_kops = -1, col_util = -1;
+    double base_kops, base_ci, base_util, kops, ci, delta;
+
+    if ((fp = fopen(path, "r")) == NULL) {
+	sprintf(msg, "Could not open baseline %s", path);
+	unix_error(msg);
+    }
+
+    /* Locate the columns by name, so older and newer files still match */
+    if (fgets(line, MAXLINE, fp) == NULL)
+	app_error("Empty baseline file");
+    nfields = split_csv(line, fields);
+    for (i = 0; i < nfields; i++) {
+	if (!strcmp(fields[i], "allocator")) col_alloc = i;
+	else if (!strcmp(fields[i], "trace")) col_trace = i;
+	else if (!strcmp(fields[i], "valid")) col_valid = i;
+	else if (!strcmp(fields[i], "secs")) col_secs = i;
+	else if (!strcmp(fields[i], "secs_ci")) col_ci = i;
+	else if (!strcmp(fields[i], "kops")) col_kops = i;
+	else if (!strcmp(fields[i], "util")) col_util = i;
+    }
+    if (col_alloc < 0 || col_trace < 0 || col_valid < 0 || col_kops < 0 ||
+	col_util < 0)
+	app_error("Baseline file is not a results CSV written by --csv");
+
+    printf("\nBaseline comparison for %s against %s:\n", allocator, path);
+    while (fgets(line, MAXLINE, fp) != NULL) {
+	if (split_csv(line, fields) < nfields || 
+	    strcmp(fields[col_alloc], allocator))
+	    continue;
+	for (i = 0; i < n; i++)
+	    if (!strcmp(fields[col_trace], tracefiles[i]))
+		break;
+	if (i == n || !atoi(fields[col_valid]))
+	    continue;
+	matched++;
+
+	if (!stats[i].valid) {
+	    printf("REGRESSION %s: no longer valid\n", tracefiles[i]);
+	    regressions++;
+	    continue;
+	}
+
+	/* Throughput, with the confidence intervals converted to Kops */
+	base_kops = atof(fields[col_kops]);
+	base_ci = (col_ci >= 0 && col_secs >= 0 && atof(fields[col_secs]) > 0) ?
+	    base_kops * atof(fields[col_ci]) / atof(fields[col_secs]) : 0.0;
+	kops = (stats[i].ops/1e3)/stats[i].secs;
+	ci = kops * stats[i].secs_ci / stats[i].secs;
+	delta = base_kops - kops;
+	if (delta > base_kops * tol / 100.0 && 
+	    delta > sqrt(base_ci*base_ci + ci*ci)) {
+	    printf("REGRESSION %s: throughput %.0f -> %.0f Kops (%.1f%%)\n",
+		   tracefiles[i], base_kops, kops, -100.0 * delta / base_kops);
+	    regressions++;
+	}
+
+	/* Utilization */
+	base_util = atof(fields[col_util]);
+	if ((base_util - stats[i].util) * 100.0 > UTIL_TOL) {
+	    printf("REGRESSION %s: util %.1f%% -> %.1f%%\n", tracefiles[i],
+		   base_util * 100.0, stats[i].util * 100.0);
+	    regressions++;
+	}
+    }
+    fclose(fp);
+
+    printf("%d of %d traces compared, %d regressions\n", 
+	   matched, n, regressions);
+    return regressions;
+}
+
 /* 
  * app_error - Report an arbitrary application error
  */
@@ -985,6 +2369,22 @@ void app_error(char *msg)
     exit(1);
 }
 
+#if TRACE_LEVEL >= TRACE_EVENTS
+/*
+ * crash_handler - on a fatal signal, dump the allocator's event log
+ *    (see mmtrace.h) to stderr and die of the signal as we would have
+ */
+static void crash_handler(int sig)
+{
+    static char msg[] = "mdriver: fatal signal, last allocator events:\n";
+
+    if (write(STDERR_FILENO, msg, sizeof(msg) - 1) > 0)
+	mmtrace_dump(STDERR_FILENO);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+#endif
+
 /* 
  * unix_error - Report a Unix-style error
  */
@@ -1008,14 +2408,46 @@ void malloc_error(int tracenum, int opnum, char *msg)
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    int i;
+
+    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>] [-T <method>]\n");
+    fprintf(stderr, "               [-A <allocator>[,<allocator>...]]\n");
+    fprintf(stderr, "               [--json <file>] [--csv <file>] [--baseline <file>]\n");
+    fprintf(stderr, "               [--timeline <file> [--every <n>]] [--threads]\n");
+    fprintf(stderr, "               [-j <n> [--parallel-speed]]\n");
+    fprintf(stderr, "               [--pin <cpu>] [--prio] [--runs <n>] [--calibrate]\n");
+    fprintf(stderr, "               [--touch <pct>] [--locality] [--footprint] [--hint]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-a         Don't check the team structure.\n");
+    fprintf(stderr, "\t-A <list>  Allocators to evaluate (default %s):\n", 
+	    backends[0]->name);
+    for (i = 0; backends[i] != NULL; i++)
+	fprintf(stderr, "\t             %-10s %s\n", backends[i]->name, 
+		backends[i]->description);
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
-    fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-j <n>     Check up to <n> traces at once (0: one per CPU).\n");
+    fprintf(stderr, "\t-l         Run libc malloc as well (same as adding libc to -A).\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
+    fprintf(stderr, "\t-T <meth>  Timing method: fcyc, itimer, gettod, mono or tsc.\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
+    fprintf(stderr, "\t--json <file>      Write per-trace results as JSON (- for stdout).\n");
+    fprintf(stderr, "\t--csv <file>       Write per-trace results as CSV (- for stdout).\n");
+    fprintf(stderr, "\t--baseline <file>  Compare against a --csv file, exit 2 on regressions.\n");
+    fprintf(stderr, "\t--tolerance <pct>  Kops drop that --baseline ignores (default %.0f%%).\n", THRUPUT_TOL);
+    fprintf(stderr, "\t--timeline <file>  Write heap samples over each trace as CSV (- for stdout).\n");
+    fprintf(stderr, "\t--every <n>        Ops between --timeline samples (default %d).\n", TIMELINE_EVERY);
+    fprintf(stderr, "\t--threads          Also replay each trace thread on a thread of its own.\n");
+    fprintf(stderr, "\t--parallel-speed   Let the -j workers time the traces as well.\n");
+    fprintf(stderr, "\t--pin <cpu>        Run on CPU <cpu> only.\n");
+    fprintf(stderr, "\t--prio             Run at the highest scheduling priority allowed.\n");
+    fprintf(stderr, "\t--runs <n>         Time each trace <n> times; report the median and cv.\n");
+    fprintf(stderr, "\t--calibrate        Time mdriver's own loop too, and report net Kops.\n");
+    fprintf(stderr, "\t--touch <pct>      Touch <pct>%% of each payload, and count cache misses.\n");
+    fprintf(stderr, "\t--locality         Report how close together the blocks are placed.\n");
+    fprintf(stderr, "\t--footprint        Report the physical memory used, libc's too.\n");
+    fprintf(stderr, "\t--hint             Start with the heap size the trace suggests, if the\n");
+    fprintf(stderr, "\t                   package takes one (mm_init_hint).\n");
 }
@@ -2,6 +2,11 @@
  * memlib.c - a module that simulates the memory system.  Needed because it 
  *            allows us to interleave calls from the student's malloc package 
  *            with the system's malloc package in libc.
+ *
+ *            Built with -DMEMLIB_MMAP, the heap is instead a range of
+ *            address space reserved with mmap, which mem_sbrk makes
+ *            readable and writable as it grows. This never calls malloc,
+ *            so it can sit under a malloc that replaces the one in libc.
  */
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,7 +23,11 @@
 static char *mem_start_brk;  /* points to first byte of heap */
 static char *mem_brk;        /* points to last byte of heap */
 static char *mem_max_addr;   /* largest legal heap address */ 
+#ifdef MEMLIB_MMAP
+static char *mem_commit_brk; /* end of the readable and writable part */
+#endif
 
+#ifndef MEMLIB_MMAP
 /* 
  * mem_init - initialize the memory system model
  */
@@ -41,6 +50,97 @@ void mem_deinit(void)
 {
     free(mem_start_brk);
 }
+#else
+/* 
+ * mem_init - reserve the address space of the heap, without touching it
+ */
+void mem_init(void)
+{
+    mem_start_brk = mmap(NULL, MMAP_HEAP, PROT_NONE, 
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem_start_brk == MAP_FAILED) {
+	fprintf(stderr, "mem_init_vm: mmap error\n");
+	exit(1);
+    }
+
+    mem_max_addr = mem_start_brk + MMAP_HEAP; /* max legal heap address */
+    mem_brk = mem_start_brk;                  /* heap is empty initially */
+    mem_commit_brk = mem_start_brk;           /* nothing usable yet */
+}
+
+/* 
+ * mem_deinit - give the address space of the heap back
+ */
+void mem_deinit(void)
+{
+    munmap(mem_start_brk, MMAP_HEAP);
+}
+#endif
+
+/*
+ * mem_prefault - touch every page the heap can use, so that the page
+ *    faults are taken now rather than in the first timed run
+ */
+void mem_prefault(void)
+{
+#ifdef MEMLIB_MMAP
+    char *end = mem_commit_brk;   /* the rest isn't writable yet */
+#else
+    char *end = mem_max_addr;
+#endif
+    size_t page = mem_pagesize();
+    volatile char *p;
+
+    for (p = mem_start_brk; p < end; p += page)
+	*p = 0;
+}
+
+/*
+ * mem_discard - give the pages of the heap back to the kernel, so that
+ *    mem_resident counts only the pages touched from now on. The heap
+ *    reads as zeros afterwards.
+ */
+void mem_discard(void)
+{
+#ifdef MEMLIB_MMAP
+    char *end = mem_commit_brk;
+#else
+    char *end = mem_max_addr;
+#endif
+    size_t page = mem_pagesize();
+    char *lo, *hi;
+
+    /* Only whole pages; the one malloc's header is on must stay */
+    lo = (char *)(((size_t)mem_start_brk + page - 1) & ~(page - 1));
+    hi = (char *)((size_t)end & ~(page - 1));
+    if (hi > lo)
+	madvise(lo, hi - lo, MADV_DONTNEED);
+}
+
+/*
+ * mem_resident - bytes of the heap that are in physical memory, in 
+ *    whole pages
+ */
+size_t mem_resident(void)
+{
+    unsigned char vec[1024];
+    size_t page = mem_pagesize();
+    size_t resident = 0, n, i;
+    char *p, *end = mem_brk;
+
+    p = (char *)((size_t)mem_start_brk & ~(page - 1));
+    while (p < end) {
+	n = (end - p + page - 1) / page;
+	if (n > sizeof(vec))
+	    n = sizeof(vec);
+	if (mincore(p, n * page, vec) < 0)
+	    return 0;
+	for (i = 0; i < n; i++)
+	    resident += (vec[i] & 1) * page;
+	p += n * page;
+    }
+    return resident;
+}
 
 /*
  * mem_reset_brk - reset the simulated brk pointer to make an empty heap
@@ -59,11 +159,25 @@ void *mem_sbrk(int incr)
 {
     char *old_brk = mem_brk;
 
-    if ( (incr < 0) || ((mem_brk + incr) > mem_max_addr)) {
+    if ( (incr < 0) || (incr > mem_max_addr - mem_brk)) {
 	errno = ENOMEM;
 	fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
 	return (void *)-1;
     }
+#ifdef MEMLIB_MMAP
+    /* Make the reservation usable up to the next commit boundary */
+    if (mem_brk + incr > mem_commit_brk) {
+	size_t len = (mem_brk + incr - mem_commit_brk + MMAP_COMMIT - 1) 
+	    & ~(size_t)(MMAP_COMMIT - 1);
+	if (len > (size_t)(mem_max_addr - mem_commit_brk))
+	    len = mem_max_addr - mem_commit_brk;
+	if (mprotect(mem_commit_brk, len, PROT_READ | PROT_WRITE) < 0) {
+	    errno = ENOMEM;
+	    return (void *)-1;
+	}
+	mem_commit_brk += len;
+    }
+#endif
     mem_brk += incr;
     return (void *)old_brk;
 }
@@ -2,6 +2,9 @@
 
 void mem_init(void);               
 void mem_deinit(void);
+void mem_prefault(void);
+void mem_discard(void);
+size_t mem_resident(void);
 void *mem_sbrk(int incr);
 void mem_reset_brk(void); 
 void *mem_heap_lo(void);
@@ -0,0 +1,541 @@
+/*
+ * mkclasses.c - Generate the size class table of mm_core.h
+ *
+ * Writes a header with the size classes described by a small spec and
+ * the tables of a size-to-class lookup without loops or divisions:
+ *
+ *   - the smallest class holds blocks of up to 2*align bytes
+ *   - above that, each power of two (2^g, 2^(g+1)] is cut into classes
+ *     of equal spacing, a power of two between align and 2^g: the one
+ *     given with -s for the range the group lies in, or else the largest
+ *     that keeps the spacing within the given fraction of 2^g (-w), which
+ *     bounds the waste of rounding a block up to its class
+ *   - blocks larger than the max (-m) all go in the last class
+ *
+ * With -p, the classes are fitted to the requests of one or more traces
+ * instead: -n classes whose limits minimize the bytes lost to rounding
+ * every block of up to max bytes up to the limit of its class, weighted
+ * by how often the traces ask for that size (found by dynamic programming
+ * over limits on a grid of SUBCLASSES per power of two). Blocks are taken
+ * to be the request plus align bytes of tags, rounded up to align.
+ *
+ * The lookup (mm_size_class in the header) takes g from the leading
+ * zeros of size-1, shifts size-1 right by as many bits as the finest
+ * class boundary in that group allows, and finds the class in a small
+ * map indexed by the result. mkclasses checks it against a linear search
+ * over the limits before writing anything.
+ *
+ * Usage: mkclasses [-a align] [-s upto:spacing]... [-w waste%] [-m max] [-o file]
+ *        mkclasses [-a align] -n classes -p trace... [-m max] [-o file]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+/* Misc */
+#define MAXCLASSES  255   /* the map holds class numbers in a byte */
+#define MAXRANGES    16   /* -s options */
+#define GROUPS       64   /* power-of-two groups of a 64-bit size */
+#define CONSTANT     63   /* shift of a group that is all one class */
+#define MAXMAP     4096   /* entries in the map */
+#define MAXTRACES    64   /* -p options */
+#define SUBCLASSES   16   /* limits -p may use per power of two */
+
+/* Defaults of the spec */
+#define ALIGN        8
+#define WASTE       25
+#define MAXSIZE  (1 << 14)
+
+/* A -s range: groups up to "upto" bytes have this spacing */
+typedef struct {
+    unsigned long upto;
+    unsigned long spacing;
+} range_t;
+
+/* The lookup tables for a set of class limits */
+typedef struct {
+    int shift[GROUPS];
+    int base[GROUPS];
+    unsigned char map[MAXMAP];
+    int map_len;
+} lookup_t;
+
+int verbose = 0; /* used by trace.c */
+
+/* Function prototypes */
+static void usage(void);
+static void app_error(char *msg);
+
+/**********************************
+ * Helpers
+ **********************************/
+
+static int is_pow2(unsigned long x)
+{
+    return x && !(x & (x - 1));
+}
+
+/* Largest power of two <= x (x > 0) */
+static unsigned long pow2_floor(unsigned long x)
+{
+    while (x & (x - 1))
+        x &= x - 1;
+    return x;
+}
+
+/* floor(log2(x)) for x > 0 */
+static int log2_floor(unsigned long long x)
+{
+    return 63 - __builtin_clzll(x);
+}
+
+/* The class of size by linear search: the first with a limit >= size */
+static int linear_class(unsigned long *limits, int nlimits, unsigned long long size)
+{
+    int i;
+
+    for (i = 0; i < nlimits; i++)
+        if (size <= limits[i])
+            break;
+    return i;
+}
+
+/* The class of size with the lookup tables, as mm_size_class does it */
+static int table_class(lookup_t *t, unsigned long long size)
+{
+    unsigned long long s = (size - 1) | 1;
+    int g = log2_floor(s);
+
+    return t->map[t->base[g] + (int)(s >> t->shift[g])];
+}
+
+/**********************************
+ * Classes and tables
+ **********************************/
+
+/*
+ * make_limits - the class limits of the spec; returns how many there
+ *     are (the last, unbounded class has none)
+ */
+static int make_limits(unsigned long align, range_t *ranges, int nranges,
+                       int waste, unsigned long max, unsigned long *limits)
+{
+    unsigned long lo, spacing, l;
+    int i, n = 0;
+
+    limits[n++] = 2 * align;
+    for (lo = 2 * align; lo < max; lo *= 2) {
+        spacing = 0;
+        for (i = 0; i < nranges && !spacing; i++)
+            if (2 * lo <= ranges[i].upto)
+                spacing = pow2_floor(ranges[i].spacing);
+        if (!spacing)
+            spacing = pow2_floor(lo * waste / 100 ? lo * waste / 100 : 1);
+        if (spacing < align)
+            spacing = align;
+        if (spacing > lo)
+            spacing = lo;
+        for (l = lo + spacing; l <= 2 * lo; l += spacing) {
+            if (n == MAXCLASSES - 1)
+                app_error("too many classes");
+            limits[n++] = l;
+        }
+    }
+    return n;
+}
+
+/*
+ * make_lookup - build the tables that map a size to the first class
+ *     whose limit is at least that size
+ */
+static void make_lookup(unsigned long *limits, int nlimits, lookup_t *t)
+{
+    unsigned long long lo, first;
+    int g, k, i, j, n;
+
+    t->map_len = 0;
+    for (g = 0; g < GROUPS; g++) {
+        /* Sizes with size-1 in [2^g, 2^(g+1)): find the finest boundary */
+        lo = 1ULL << g;
+        k = CONSTANT;
+        for (i = 0; i < nlimits; i++)
+            if (limits[i] > lo && limits[i] < 2 * lo &&
+                __builtin_ctzll(limits[i]) < k)
+                k = __builtin_ctzll(limits[i]);
+
+        n = (k == CONSTANT) ? 1 : 1 << (g - k);
+        first = lo >> k;
+        if (t->map_len + n > MAXMAP)
+            app_error("class boundaries too fine for the map");
+        t->shift[g] = k;
+        t->base[g] = t->map_len - (int)first;
+        for (j = 0; j < n; j++)
+            t->map[t->map_len++] = linear_class(limits, nlimits,
+                (k == CONSTANT ? lo : (first + j) << k) + 1);
+    }
+}
+
+/*
+ * check_size - exit if the tables and the linear search disagree on size
+ */
+static void check_size(unsigned long *limits, int nlimits, lookup_t *t,
+                       unsigned long long size)
+{
+    if (table_class(t, size) != linear_class(limits, nlimits, size)) {
+        fprintf(stderr, "mkclasses: lookup disagrees at size %llu\n", size);
+        exit(1);
+    }
+}
+
+/*
+ * check_lookup - compare the tables with a linear search, for every size
+ *     up to well past the last limit and around every power of two
+ */
+static void check_lookup(unsigned long *limits, int nlimits, lookup_t *t)
+{
+    unsigned long long size, top = 4 * (unsigned long long)limits[nlimits - 1];
+    int g;
+
+    for (size = 1; size <= top; size++)
+        check_size(limits, nlimits, t, size);
+    for (g = 1; g < GROUPS; g++) {
+        check_size(limits, nlimits, t, 1ULL << g);
+        check_size(limits, nlimits, t, (1ULL << g) + 1);
+        check_size(limits, nlimits, t, (1ULL << g) - 1);
+    }
+}
+
+/**********************************
+ * Profile-guided classes
+ **********************************/
+
+/* The block size of a request of size bytes */
+static unsigned long block_size(unsigned long align, unsigned long size)
+{
+    unsigned long b = (size + 2 * align - 1) / align * align;
+
+    return b < 2 * align ? 2 * align : b;
+}
+
+/*
+ * read_profile - add the block sizes the traces ask for (allocs and
+ *     reallocs) to hist, which counts blocks of b bytes in hist[b/align]
+ *     for b up to max; returns the number of larger ones
+ */
+static double read_profile(char **traces, int ntraces, unsigned long align,
+                           unsigned long max, double *hist)
+{
+    trace_reader_t *reader;
+    traceop_t op;
+    unsigned long b;
+    double over = 0;
+    int i;
+
+    for (i = 0; i < ntraces; i++) {
+        reader = open_trace("", traces[i]);
+        while (next_op(reader, &op)) {
+            if (op.type == FREE)
+                continue;
+            b = block_size(align, op.size);
+            if (b <= max)
+                hist[b / align]++;
+            else
+                over++;
+        }
+        close_trace(reader);
+    }
+    return over;
+}
+
+/*
+ * lost_bytes - bytes lost to rounding the blocks in hist up to limits
+ */
+static double lost_bytes(unsigned long *limits, int nlimits,
+                         unsigned long align, unsigned long max, double *hist)
+{
+    double lost = 0;
+    unsigned long b;
+    int c = 0;
+
+    for (b = align; b <= max; b += align) {
+        while (c < nlimits - 1 && b > limits[c])
+            c++;
+        lost += hist[b / align] * (limits[c] - b);
+    }
+    return lost;
+}
+
+/*
+ * fit_limits - the nlimits limits, the last of them max, that lose the
+ *     fewest bytes on the blocks in hist. Returns the number of limits,
+ *     fewer than nlimits if there aren't that many candidates.
+ */
+static int fit_limits(unsigned long align, unsigned long max, double *hist,
+                       int nlimits, unsigned long *limits)
+{
+    unsigned long *cand, b, step;
+    double *count, *bytes, *cost, *prev_cost, c;
+    int *from, m = 0, i, j, k;
+
+    /* Candidate limits: the grid, and the sums of the blocks up to each */
+    cand = calloc(max / align + 1, sizeof(unsigned long));
+    count = calloc(max / align + 1, sizeof(double));
+    bytes = calloc(max / align + 1, sizeof(double));
+    if (!cand || !count || !bytes)
+        app_error("out of memory");
+    for (b = 2 * align; b <= max; b += align) {
+        step = (1UL << (63 - __builtin_clzll(b - 1))) / SUBCLASSES;
+        count[m] += hist[b / align];
+        bytes[m] += hist[b / align] * b;
+        if (step > align && b % step)
+            continue;
+        cand[m++] = b;
+        count[m] = count[m - 1];
+        bytes[m] = bytes[m - 1];
+    }
+    if (nlimits > m)
+        nlimits = m;
+
+    /* cost[k][j]: least loss of the blocks up to cand[j] in k+1 classes,
+       the last ending at cand[j]; from[k][j] is where that class begins */
+    cost = malloc((size_t)nlimits * m * sizeof(double));
+    from = malloc((size_t)nlimits * m * sizeof(int));
+    if (!cost || !from)
+        app_error("out of memory");
+    for (j = 0; j < m; j++)
+        cost[j] = cand[j] * count[j] - bytes[j];
+    for (k = 1; k < nlimits; k++) {
+        prev_cost = cost + (k - 1) * m;
+        for (j = 0; j < m; j++) {
+            cost[k * m + j] = 1e300;
+            for (i = k - 1; i < j; i++) {
+                c = prev_cost[i] + cand[j] * (count[j] - count[i]) -
+                    (bytes[j] - bytes[i]);
+                if (c < cost[k * m + j]) {
+                    cost[k * m + j] = c;
+                    from[k * m + j] = i;
+                }
+            }
+        }
+    }
+
+    /* Walk back from max */
+    for (k = nlimits - 1, j = m - 1; k >= 0; k--) {
+        limits[k] = cand[j];
+        if (k > 0)
+            j = from[k * m + j];
+    }
+    free(cand);
+    free(count);
+    free(bytes);
+    free(cost);
+    free(from);
+    return nlimits;
+}
+
+/*
+ * write_header - write the classes and the lookup tables to fp, as the
+ *     header file name
+ */
+static void write_header(FILE *fp, char *name, char *spec,
+                         unsigned long *limits, int nlimits, lookup_t *t)
+{
+    int i;
+
+    fprintf(fp, "/*\n");
+    fprintf(fp, " * %s - Size classes, generated by\n", name);
+    fprintf(fp, " *\n");
+    fprintf(fp, " *   %s\n", spec);
+    fprintf(fp, " *\n");
+    fprintf(fp, " * Do not edit; see mkclasses.c.\n");
+    fprintf(fp, " */\n");
+    fprintf(fp, "#ifndef __MM_CLASSES_H_\n");
+    fprintf(fp, "#define __MM_CLASSES_H_\n\n");
+    fprintf(fp, "#include <stddef.h>\n\n");
+    fprintf(fp, "#define MM_CLASSES %d\n\n", nlimits + 1);
+
+    fprintf(fp, "/* Largest block size of each class but the last, "
+            "which takes the rest */\n");
+    fprintf(fp, "static const size_t mm_class_limit[%d] = {", nlimits);
+    for (i = 0; i < nlimits; i++)
+        fprintf(fp, "%s%lu%s", i % 8 ? " " : "\n    ", limits[i],
+                i < nlimits - 1 ? "," : "\n");
+    fprintf(fp, "};\n\n");
+
+    fprintf(fp, "/* For each g = floor(log2(size-1)): how far to shift size-1, "
+            "and where\n   the result indexes mm_class_map */\n");
+    fprintf(fp, "static const unsigned char mm_class_shift[%d] = {", GROUPS);
+    for (i = 0; i < GROUPS; i++)
+        fprintf(fp, "%s%d%s", i % 16 ? " " : "\n    ", t->shift[i],
+                i < GROUPS - 1 ? "," : "\n");
+    fprintf(fp, "};\n");
+    fprintf(fp, "static const short mm_class_base[%d] = {", GROUPS);
+    for (i = 0; i < GROUPS; i++)
+        fprintf(fp, "%s%d%s", i % 12 ? " " : "\n    ", t->base[i],
+                i < GROUPS - 1 ? "," : "\n");
+    fprintf(fp, "};\n");
+    fprintf(fp, "static const unsigned char mm_class_map[%d] = {", t->map_len);
+    for (i = 0; i < t->map_len; i++)
+        fprintf(fp, "%s%d%s", i % 16 ? " " : "\n    ", t->map[i],
+                i < t->map_len - 1 ? "," : "\n");
+    fprintf(fp, "};\n\n");
+
+    fprintf(fp, "/* The class of a block of size bytes */\n");
+    fprintf(fp, "static inline int mm_size_class(size_t size)\n");
+    fprintf(fp, "{\n");
+    fprintf(fp, "    unsigned long long s = (size - 1) | 1;\n");
+    fprintf(fp, "    int g = 63 - __builtin_clzll(s);\n\n");
+    fprintf(fp, "    return mm_class_map[mm_class_base[g] + (int)(s >> mm_class_shift[g])];\n");
+    fprintf(fp, "}\n\n");
+    fprintf(fp, "#endif /* __MM_CLASSES_H_ */\n");
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long limits[MAXCLASSES];
+    range_t ranges[MAXRANGES];
+    lookup_t lookup;
+    unsigned long spec_limits[MAXCLASSES];
+    unsigned long align = ALIGN, max = MAXSIZE;
+    int c, i, nranges = 0, nlimits, waste = WASTE, nclasses = 0;
+    int ntraces = 0, nspec;
+    char *outfile = NULL, *name, *traces[MAXTRACES], spec[4096];
+    double *hist, over, total;
+    FILE *fp = stdout;
+
+    while ((c = getopt(argc, argv, "a:s:w:m:n:p:o:h")) != EOF) {
+        switch (c) {
+        case 'a': /* Alignment, and spacing of the smallest classes */
+            align = strtoul(optarg, NULL, 0);
+            if (!is_pow2(align))
+                app_error("-a must be a power of two");
+            break;
+        case 's': /* Spacing of the classes up to a size */
+            if (nranges == MAXRANGES)
+                app_error("too many -s options");
+            if (sscanf(optarg, "%lu:%lu", &ranges[nranges].upto,
+                       &ranges[nranges].spacing) != 2 ||
+                ranges[nranges].spacing == 0)
+                app_error("-s takes <upto>:<spacing>");
+            nranges++;
+            break;
+        case 'w': /* Largest spacing, in percent of the class size */
+            waste = atoi(optarg);
+            if (waste < 1 || waste > 100)
+                app_error("-w must be between 1 and 100");
+            break;
+        case 'm': /* Largest bounded class */
+            max = strtoul(optarg, NULL, 0);
+            break;
+        case 'n': /* Number of classes to fit to the traces */
+            nclasses = atoi(optarg);
+            if (nclasses < 2 || nclasses > MAXCLASSES)
+                app_error("-n must be between 2 and 255");
+            break;
+        case 'p': /* Trace to fit the classes to */
+            if (ntraces == MAXTRACES)
+                app_error("too many -p options");
+            traces[ntraces++] = optarg;
+            break;
+        case 'o': /* Output file */
+            outfile = optarg;
+            break;
+        case 'h':
+            usage();
+            exit(0);
+        default:
+            usage();
+            exit(1);
+        }
+    }
+    if (optind != argc || !ntraces != !nclasses) {
+        usage();
+        exit(1);
+    }
+    if (!is_pow2(max) || max <= 2 * align)
+        app_error("-m must be a power of two above 2*align");
+
+    /* The spec, as a command line for the header */
+    sprintf(spec, "mkclasses -a %lu", align);
+    for (i = 0; i < nranges; i++)
+        sprintf(spec + strlen(spec), " -s %lu:%lu", ranges[i].upto, ranges[i].spacing);
+    sprintf(spec + strlen(spec), " -w %d -m %lu", waste, max);
+    if (ntraces)
+        sprintf(spec + strlen(spec), " -n %d", nclasses);
+    for (i = 0; i < ntraces; i++)
+        if (strlen(spec) + strlen(traces[i]) + 8 < sizeof(spec))
+            sprintf(spec + strlen(spec), " -p %s", traces[i]);
+
+    nlimits = nspec = make_limits(align, ranges, nranges, waste, max, spec_limits);
+    memcpy(limits, spec_limits, sizeof(limits));
+    if (ntraces) {
+        /* Fit the classes, and compare with the spec's */
+        if ((hist = calloc(max / align + 1, sizeof(double))) == NULL)
+            app_error("out of memory");
+        over = read_profile(traces, ntraces, align, max, hist);
+        nlimits = fit_limits(align, max, hist, nclasses - 1, limits);
+        for (total = 0, i = 0; i <= (int)(max / align); i++)
+            total += hist[i] * i * align;
+        fprintf(stderr, "bytes lost to rounding up to %lu: %.1f%% with %d classes "
+                "from the spec, %.1f%% with %d fitted\n", max,
+                100 * lost_bytes(spec_limits, nspec, align, max, hist) / total,
+                nspec + 1,
+                100 * lost_bytes(limits, nlimits, align, max, hist) / total,
+                nlimits + 1);
+        if (over)
+            fprintf(stderr, "%.0f blocks above %lu bytes are in the last class\n",
+                    over, max);
+        free(hist);
+    }
+    make_lookup(limits, nlimits, &lookup);
+    check_lookup(limits, nlimits, &lookup);
+
+    if (outfile && (fp = fopen(outfile, "w")) == NULL) {
+        perror(outfile);
+        exit(1);
+    }
+    if (outfile == NULL)
+        name = "mm_classes.h";
+    else if ((name = strrchr(outfile, '/')) != NULL)
+        name++;
+    else
+        name = outfile;
+    write_header(fp, name, spec, limits, nlimits, &lookup);
+    if (outfile)
+        fclose(fp);
+    fprintf(stderr, "%d classes, %d map entries\n", nlimits + 1, lookup.map_len);
+    exit(0);
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mkclasses [-h] [-a <align>] [-s <upto>:<spacing>]... "
+            "[-w <waste%%>] [-m <max>] [-o <file>]\n");
+    fprintf(stderr, "       mkclasses [-h] [-a <align>] -n <classes> -p <trace>... "
+            "[-m <max>] [-o <file>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-a <align>   Alignment of block sizes (default %d).\n", ALIGN);
+    fprintf(stderr, "\t-h           Print this message.\n");
+    fprintf(stderr, "\t-m <max>     Blocks above <max> bytes share the last class (default %d).\n", MAXSIZE);
+    fprintf(stderr, "\t-n <n>       Fit <n> classes to the traces given with -p.\n");
+    fprintf(stderr, "\t-o <file>    Write the header to <file> instead of stdout.\n");
+    fprintf(stderr, "\t-p <trace>   Fit the classes to the request sizes of <trace>.\n");
+    fprintf(stderr, "\t-s <u>:<s>   Space classes <s> bytes apart up to <u> bytes.\n");
+    fprintf(stderr, "\t-w <pct>     Elsewhere, space them at most <pct>%% of their size\n"
+            "\t             apart (default %d).\n", WASTE);
+}
+
+/*
+ * app_error - Report an error and exit
+ */
+static void app_error(char *msg)
+{
+    fprintf(stderr, "mkclasses: %s\n", msg);
+    exit(1);
+}
@@ -3,9 +3,15 @@
  * We keep a list of only the free blocks, to make the allocation only require
  * a linear search in the list of free blocks, and not all blocks (herein
  * including allocated), which in most cases is a much larger list. The list
- * insertion policy implemented here is LIFO, where we always logically insert
- * new free blocks at the root of the list, and don't order them by their
- * addresses. 
+ * insertion policy implemented here is LIFO by default, where we always
+ * logically insert new free blocks at the root of the list, and don't order
+ * them by their addresses. Address ordered insertion can be chosen at compile
+ * time instead (see INSERT_POLICY), and the fit policy, heap growth and split
+ * threshold at run time as well (see mm_config_t in mm.h).
+ *
+ * The heap grows adaptively: by a chunk at a time, or by geometrically larger
+ * amounts while the program keeps running out of free blocks and the heap is
+ * well used (see growSize).
  * 
  * Credit: Macros and certain implementation functions inspired from the book:
  * Computer Systems - A Programmer's Perspective by Bryant & O'Hallaron *
@@ -16,9 +22,11 @@
 #include <assert.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include "mm.h"
 #include "memlib.h"
+#include "mmtrace.h"
 
 team_t team = {
     /* Team name */
@@ -37,16 +45,54 @@ team_t team = {
 /*
  * Function declarations
  */
-int mm_check();
+int mm_check(void);
 
-#define DEBUG 0
 #define HEAP_CHECK 0
-#define PRINT_LISTS 0
+#define CHECK_EVERY 1000 // Operations between full heap checks
+#define PRINT_LISTS 0 // Print the lists in mm_check (with TRACE_LEVEL 2)
+#define STATS 1
 #define WSIZE 4
 #define DSIZE (2 * WSIZE) // Must be double word
-#define CHUNKSIZE 4096
-
-#define debugprint(format, args...) if (DEBUG) printf(format, ## args)
+#define CHUNKSIZE 4096 // Default least heap extension (mm_config_t.chunk_size)
+#define SPLIT_MIN (2 * DSIZE) // Default smallest remainder split off (mm_config_t.split_min)
+
+// Free list policies, chosen at compile time (e.g. -DINSERT_POLICY=INSERT_ADDRESS).
+// LIFO inserts freed blocks at the root; ADDRESS keeps the list sorted by
+// address, which tends to fragment less, and finds each block's place
+// through the region index below rather than by walking the list.
+#define INSERT_LIFO 0
+#define INSERT_ADDRESS 1
+// FIRST searches from the root every time; NEXT resumes where the last
+// search ended (the rover) and wraps around to the root; BEST searches the
+// whole list for the smallest block that fits, unless one fits exactly.
+// FIT_POLICY is only the default; mm_config_t.fit_policy chooses at run time.
+#define FIT_FIRST MM_FIT_FIRST
+#define FIT_NEXT MM_FIT_NEXT
+#define FIT_BEST MM_FIT_BEST
+
+#ifndef INSERT_POLICY
+#define INSERT_POLICY INSERT_LIFO
+#endif
+#ifndef FIT_POLICY
+#define FIT_POLICY FIT_FIRST
+#endif
+
+// Heap growth policies; GROW_POLICY is the default of mm_config_t.grow_policy.
+// FIXED grows by MAX(request, chunk) every time; ADAPTIVE as in growSize.
+#define GROW_FIXED MM_GROW_FIXED
+#define GROW_ADAPTIVE MM_GROW_ADAPTIVE
+
+#ifndef GROW_POLICY
+#define GROW_POLICY GROW_ADAPTIVE
+#endif
+#define GROW_WINDOW 256 // Growth is sustained if it recurs within this many mallocs
+#define GROW_LIMIT 4 // A geometric step is at most 1/GROW_LIMIT of the heap
+#define GROW_UTIL 0.5 // Below this payload/heap ratio, steps stay at chunk size
+
+// Counter updates for mm_stats; these compile away when STATS is 0.
+#define STAT_INC(field) do { if (STATS) counters.field++; } while (0)
+#define STAT_DEC(field) do { if (STATS) counters.field--; } while (0)
+#define STAT_ADD(field, n) do { if (STATS) counters.field += (n); } while (0)
 
 /*
  * Credit: Most of these macros taken from the course text-book (information and ISBN in top comment)
@@ -75,13 +121,127 @@ int mm_check();
 
 #define IS_IN_RANGE(bp) ((((size_t) mem_heap_lo()) <= ((size_t) bp)) && (((size_t) mem_heap_hi()) >= ((size_t) bp)))
 
+// Allocated blocks remember their "waste", the bytes that are neither payload
+// nor boundary tags (ALIGN padding plus any slack place didn't split off), so
+// mm_stats can attribute every byte of the heap. Block sizes are multiples of
+// DSIZE, which leaves TAG_BITS spare bits above the allocated bit in both
+// tags: the header holds the low half of the waste and the footer the high.
+// Larger waste, left by a split_min above 2 * DSIZE, doesn't fit there; the
+// tags then hold WASTE_BIG and the word before the footer, which lies in the
+// waste itself, holds the waste.
+#define TAG_BITS 2
+#define TAG_MASK ((1 << TAG_BITS) - 1)
+#define WASTE_BIG ((1 << 2 * TAG_BITS) - 1)
+#define TAG_WASTE(bp) (((GET(HDRP(bp)) >> 1) & TAG_MASK) | (((GET(FTRP(bp)) >> 1) & TAG_MASK) << TAG_BITS))
+#define GET_WASTE(bp) (TAG_WASTE(bp) == WASTE_BIG ? GET((FTRP(bp) - WSIZE)) : TAG_WASTE(bp))
+
 // Root of the free list (implementation)
-void *root;
+static void *root;
+
+// Byte accounting reported by mm_stats, kept up to date by every call.
+static size_t payloadBytes;  // requested bytes in allocated blocks
+static size_t padBytes;      // ALIGN rounding in allocated blocks
+static size_t slackBytes;    // unsplit remainders in allocated blocks
+static size_t strandedBytes; // freed blocks mm_free couldn't give back
+static size_t allocBlocks;   // number of allocated blocks
+
+// Call counters reported by mm_stats (only the counter fields are used). The
+// allocator is single threaded, like memlib under it, so one static set of
+// counters serves instead of per-thread ones that are summed when read.
+static mm_stats_t counters;
 
 // This is simply used to point to the physical start of the heap. Only used for
 // debugging and visually printing of lists, and is in no way related to the
 // implementation of the explicit free list.
-void *heap_listp;
+static void *heap_listp;
+
+// Where the next fit search resumes (NULL for the root). Blocks leaving the
+// free list move it on to their successor.
+static void *rover;
+
+// The tunable parameters (see mm.h). mm_init copies them into the variables
+// below, which the rest of the package uses, so that a change can't take
+// effect in the middle of a heap.
+static mm_config_t config = {CHUNKSIZE, SPLIT_MIN, FIT_POLICY, GROW_POLICY};
+static int configRead; // Whether the environment has been applied to config
+static size_t chunkSize;
+static size_t splitMin;
+static int fitPolicy;
+static int growPolicy;
+
+// Adaptive growth state: the size of the next geometric step, and the mallocs
+// since the heap last grew.
+static size_t growStep;
+static size_t growAge;
+
+#if INSERT_POLICY == INSERT_ADDRESS
+// Region index for address ordered insertion. The heap is cut into REGIONS
+// regions of 1 << regionShift bytes; regionLast holds the highest addressed
+// free block that starts in each region (or NULL), and regionBits has a bit
+// set for every region that has one. The free block before a new one is then
+// found from its own region, or the nearest nonempty region below it. The
+// regions double in size, and the index is rebuilt, as the heap outgrows them.
+#define REGIONS 4096
+#define REGION_SHIFT 12 // Initial region size, 4 KB
+#define REGION_WORD (8 * sizeof(unsigned long long))
+#define REGION_OF(bp) (((size_t) (bp) - (size_t) mem_heap_lo()) >> regionShift)
+
+static void *regionLast[REGIONS];
+static unsigned long long regionBits[REGIONS / REGION_WORD];
+static int regionShift;
+
+static void regionSet(size_t r, void *bp) {
+    regionLast[r] = bp;
+    if (bp) regionBits[r / REGION_WORD] |= 1ULL << (r % REGION_WORD);
+    else regionBits[r / REGION_WORD] &= ~(1ULL << (r % REGION_WORD));
+}
+
+/*
+ * Returns the highest addressed free block in the regions below r, or NULL.
+ */
+static void *regionBelow(size_t r) {
+    size_t w = r / REGION_WORD;
+    unsigned long long bits = regionBits[w] & ((1ULL << (r % REGION_WORD)) - 1);
+
+    while (!bits) {
+        if (w == 0) return NULL;
+        bits = regionBits[--w];
+    }
+    return regionLast[w * REGION_WORD + REGION_WORD - 1 - __builtin_clzll(bits)];
+}
+
+/*
+ * Records that the free block bp has joined the list.
+ */
+static void regionAdd(void *bp) {
+    size_t r = REGION_OF(bp);
+    if (!regionLast[r] || regionLast[r] < bp) regionSet(r, bp);
+}
+
+/*
+ * Records that the free block bp, whose list predecessor is prev, is leaving
+ * the list.
+ */
+static void regionRemove(void *bp, void *prev) {
+    size_t r = REGION_OF(bp);
+    if (regionLast[r] == bp) regionSet(r, prev && REGION_OF(prev) == r ? prev : NULL);
+}
+
+/*
+ * Makes the regions cover a heap of "size" bytes, rebuilding the index from
+ * the free list if they had to grow.
+ */
+static void regionFit(size_t size) {
+    int shift = regionShift;
+    while (((size_t) REGIONS << shift) < size) shift++;
+    if (shift == regionShift) return;
+
+    regionShift = shift;
+    memset(regionLast, 0, sizeof(regionLast));
+    memset(regionBits, 0, sizeof(regionBits));
+    for (void *bp = root; bp; bp = GET_ADDR(NEXTP(bp))) regionSet(REGION_OF(bp), bp);
+}
+#endif
 
 /*
  * This helper function logically removes a block from the free block list.
@@ -96,6 +256,10 @@ static void removeBlock(void *bp) {
     // Logically skip bp
     void *logicalNext = GET_ADDR(NEXTP(bp));
     void *logicalPrev = GET_ADDR(PREVP(bp));
+#if INSERT_POLICY == INSERT_ADDRESS
+    regionRemove(bp, logicalPrev);
+#endif
+    if (fitPolicy == FIT_NEXT && rover == bp) rover = logicalNext;
     if (logicalNext) PUT_ADDR(PREVP(logicalNext), logicalPrev);
     if (logicalPrev) {
         PUT_ADDR(NEXTP(logicalPrev), logicalNext);
@@ -121,9 +285,80 @@ static void updateBlockTags(void *bp, size_t boundaryTag) {
 }
 
 /*
- * Helper function to logically insert a new free block into the free list.
+ * Returns the index of the power-of-two bucket that n (> 0) falls into, as
+ * described for the size classes and probe buckets in mm.h. "first" is the
+ * smallest value of bucket 0 and "buckets" the number of buckets.
+ */
+static int bucketOf(size_t n, size_t first, int buckets) {
+    int i = 0;
+    for (n /= 2 * first; n && i < buckets - 1; n >>= 1) i++;
+    return i;
+}
+
+#define SIZE_CLASS(size) bucketOf(size, 16, MM_SIZE_CLASSES)
+
+/*
+ * Records that the allocated block bp now holds a payload of "size" bytes, by
+ * storing its waste in the spare tag bits and adding it to the accounting.
+ * Must be called after the block's tags have been (re)written.
+ */
+static void accountAlloc(void *bp, size_t size) {
+    size_t waste = GET_SIZE(HDRP(bp)) - DSIZE - size;
+    size_t pad = ALIGN(size) - DSIZE - size;
+    size_t tag = waste < WASTE_BIG ? waste : WASTE_BIG;
+
+    if (tag == WASTE_BIG) PUT(FTRP(bp) - WSIZE, waste);
+    PUT(HDRP(bp), GET(HDRP(bp)) | ((tag & TAG_MASK) << 1));
+    PUT(FTRP(bp), GET(FTRP(bp)) | (((tag >> TAG_BITS) & TAG_MASK) << 1));
+
+    payloadBytes += size;
+    padBytes += pad;
+    slackBytes += waste - pad;
+    allocBlocks++;
+    STAT_INC(live_by_class[SIZE_CLASS(GET_SIZE(HDRP(bp)))]);
+}
+
+/*
+ * Removes the allocated block bp from the accounting. Padding is always less
+ * than DSIZE and slack a multiple of it, so the waste splits unambiguously.
+ */
+static void accountFree(void *bp) {
+    size_t waste = GET_WASTE(bp);
+    size_t pad = waste % DSIZE;
+
+    payloadBytes -= GET_SIZE(HDRP(bp)) - DSIZE - waste;
+    padBytes -= pad;
+    slackBytes -= waste - pad;
+    allocBlocks--;
+    STAT_DEC(live_by_class[SIZE_CLASS(GET_SIZE(HDRP(bp)))]);
+}
+
+/*
+ * Helper function to logically insert a new free block into the free list,
+ * at the root or at its place by address depending on INSERT_POLICY.
  */
 static void insertNewBlock(void *bp) {
+#if INSERT_POLICY == INSERT_ADDRESS
+    // The free block before bp is the last one in its region if that lies
+    // below bp, else reached by going back from it, or if the region has none
+    // the last one in the nearest region below.
+    void *prev = regionLast[REGION_OF(bp)];
+    if (!prev) prev = regionBelow(REGION_OF(bp));
+    while (prev && prev > bp) prev = GET_ADDR(PREVP(prev));
+    void *next = prev ? GET_ADDR(NEXTP(prev)) : root;
+
+    PUT_ADDR(NEXTP(bp), next);
+    PUT_ADDR(PREVP(bp), prev);
+    if (next) {
+        PUT_ADDR(PREVP(next), bp);
+    }
+    if (prev) {
+        PUT_ADDR(NEXTP(prev), bp);
+    } else {
+        root = bp;
+    }
+    regionAdd(bp);
+#else
     // If empty list (no root), then we simply set root to the block
     if (!root) {
         // Make sure that the block you insert has NULL next/prev pointers
@@ -143,6 +378,121 @@ static void insertNewBlock(void *bp) {
     // Update our new root's next/prev pointers
     PUT_ADDR(NEXTP(bp), oldRoot);
     PUT_ADDR(PREVP(bp), NULL);
+#endif
+}
+
+// Small helper macro for printing an error and returning 0.
+#define PRINT_AND_FAIL(str) { printf(" \n ****** HEAP INCONSISTENCY FOUND: \"%s\" ******** \n ", str); return 0; }
+
+// Open addressing hash set of free blocks, used by mm_check. It is mmap'ed
+// rather than malloc'ed, as this package may itself be serving malloc.
+static void **freeSet;
+static size_t freeSetSlots; // Always a power of two
+
+#define SET_SLOT(bp) ((((size_t) (bp) / DSIZE) * 2654435761u) & (freeSetSlots - 1))
+
+/*
+ * Empties the free block set and makes room for n blocks in it, keeping it
+ * at most half full. Returns 0 if the memory could not be mapped.
+ */
+static int setReset(size_t n) {
+    size_t slots = 64;
+    while (slots < 2 * n) slots *= 2;
+
+    if (slots <= freeSetSlots) {
+        memset(freeSet, 0, freeSetSlots * sizeof(void *));
+        return 1;
+    }
+    if (freeSet) munmap(freeSet, freeSetSlots * sizeof(void *));
+    freeSet = mmap(NULL, slots * sizeof(void *), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (freeSet == MAP_FAILED) {
+        freeSet = NULL;
+        freeSetSlots = 0;
+        return 0;
+    }
+    freeSetSlots = slots;
+    return 1;
+}
+
+/*
+ * Adds bp to the free block set. Returns 0 if it was already there.
+ */
+static int setInsert(void *bp) {
+    size_t i = SET_SLOT(bp);
+    while (freeSet[i]) {
+        if (freeSet[i] == bp) return 0;
+        i = (i + 1) & (freeSetSlots - 1);
+    }
+    freeSet[i] = bp;
+    return 1;
+}
+
+/*
+ * Returns nonzero if bp is in the free block set.
+ */
+static int setContains(void *bp) {
+    size_t i = SET_SLOT(bp);
+    while (freeSet[i]) {
+        if (freeSet[i] == bp) return 1;
+        i = (i + 1) & (freeSetSlots - 1);
+    }
+    return 0;
+}
+
+/*
+ * Checks a single block without walking any list, so the cost does not
+ * depend on the size of the heap. Every block must be aligned, have a
+ * plausible size and matching header and footer. A free block must also be
+ * linked back to by its free list neighbours (or be the root), and must not
+ * have a free physical neighbour that escaped coalescing.
+ */
+static int checkBlock(void *bp) {
+    size_t size = GET_SIZE(HDRP(bp));
+
+    if ((size_t) bp % DSIZE) PRINT_AND_FAIL("A block pointer is not aligned.");
+    if (size < 2 * DSIZE) PRINT_AND_FAIL("A block is smaller than the minimum block size.");
+    // Only the size and allocated bit need to match, as the spare bits of
+    // allocated blocks hold different halves of the waste.
+    if (size != GET_SIZE(FTRP(bp)) || GET_ALLOC(HDRP(bp)) != GET_ALLOC(FTRP(bp))) PRINT_AND_FAIL("A block's header and footer do not match.");
+    if (GET_ALLOC(HDRP(bp))) return 1;
+
+    // "Do the pointers in the free list point to valid free blocks?"
+    void *next = GET_ADDR(NEXTP(bp));
+    void *prev = GET_ADDR(PREVP(bp));
+    if (next && (!IS_IN_RANGE(next) || GET_ALLOC(HDRP(next)))) PRINT_AND_FAIL("A free block is pointing (next) to a non-free block.");
+    if (prev && (!IS_IN_RANGE(prev) || GET_ALLOC(HDRP(prev)))) PRINT_AND_FAIL("A free block is pointing (prev) to a non-free block.");
+    if (next && GET_ADDR(PREVP(next)) != bp) PRINT_AND_FAIL("A free block's next block does not point (prev) back to it.");
+    if (prev && GET_ADDR(NEXTP(prev)) != bp) PRINT_AND_FAIL("A free block's prev block does not point (next) back to it.");
+    if (!prev && root != bp) PRINT_AND_FAIL("A free block without a prev block is not the root.");
+    if (INSERT_POLICY == INSERT_ADDRESS && next && next < bp) PRINT_AND_FAIL("The free list is not in address order.");
+
+    // "Are there any contiguous free blocks that somehow escaped coalescing?"
+    void *physNext = NEXT_BLKP(bp);
+    void *physPrev = PREV_BLKP(bp);
+    if (IS_IN_RANGE(physNext) && GET_ALLOC(HDRP(physNext)) == 0) PRINT_AND_FAIL("A free block has escaped coalescing, as it has a succeeding free block that could have been coalesced.");
+    if (IS_IN_RANGE(physPrev) && physPrev != bp && GET_ALLOC(HDRP(physPrev)) == 0) PRINT_AND_FAIL("A free block has escaped coalescing, as it has a preceding free block that could have been coalesced.");
+
+    return 1;
+}
+
+/*
+ * The check run after every operation when HEAP_CHECK is set. Only the
+ * blocks the operation could have touched are checked: the resulting block,
+ * its physical neighbours and the root of the free list (checkBlock follows
+ * their list links). Every CHECK_EVERY operations the full mm_check runs.
+ */
+static void checkOp(void *bp) {
+    static unsigned long ops = 0;
+    if (!HEAP_CHECK) return;
+
+    void *physNext = NEXT_BLKP(bp);
+    void *physPrev = PREV_BLKP(bp);
+    checkBlock(bp);
+    if (IS_IN_RANGE(physNext)) checkBlock(physNext);
+    if (IS_IN_RANGE(physPrev) && physPrev != bp) checkBlock(physPrev);
+    if (root) checkBlock(root);
+
+    if (++ops % CHECK_EVERY == 0) mm_check();
 }
 
 /*
@@ -179,7 +529,7 @@ static void *coalesce(void *bp) {
         size_t newBoundaryTag = PACK((GET_SIZE(HDRP(next)) + GET_SIZE(HDRP(bp))), 0);
         updateBlockTags(bp, newBoundaryTag);
 
-        // Add the new block to the free list (with LIFO ordering) (logically)
+        // Add the new block to the free list (logically)
         insertNewBlock(bp);
         return bp;
     }
@@ -196,7 +546,7 @@ static void *coalesce(void *bp) {
         updateBlockTags(prev, newBoundaryTag);
 
         // Add the new block (address of expanded previous block) to the free
-        // list (with LIFO ordering) (logically)
+        // list (logically)
         insertNewBlock(prev);
         return prev;
     }
@@ -214,7 +564,7 @@ static void *coalesce(void *bp) {
         updateBlockTags(prev, newBoundaryTag);
 
         // Add the new block (address of expanded previous block) to the free
-        // list (with LIFO ordering) (logically)
+        // list (logically)
         insertNewBlock(prev);
         return prev;
     }
@@ -227,32 +577,132 @@ static void *coalesce(void *bp) {
  * words, so words/wordsize bytes.
  */
 static void *extend_heap(size_t words) {
-    debugprint(" \n ********* EXTENDING HEAP WITH %i WORDS ********* \n ", words);
-    void *oldRoot = root;
+    TRACE_PRINTF(" \n ********* EXTENDING HEAP WITH %i WORDS ********* \n ", words);
+    void *bp;
     size_t size;
 
     // Get words in bytes and have it properly aligned
     /* Credit: Course textbook */
     size = (words % 2) ? (words+1) * WSIZE : words * WSIZE;
-    if ((root = mem_sbrk(size)) == (void *)-1)
+    if ((bp = mem_sbrk(size)) == (void *)-1)
         return NULL;
-
-    /* Make new root and set its next to prev root */
+    STAT_INC(extend_calls);
+    STAT_ADD(extend_bytes, size);
+    growAge = 0;
+    TRACE_EVENT(MMTRACE_EXTEND, size, (char *)bp + DSIZE, 0);
+#if INSERT_POLICY == INSERT_ADDRESS
+    regionFit(mem_heapsize());
+#endif
+
+    /* Make the new free block */
     // Alignment padding
-    root += 4;
-    PUT(root, PACK(size, 0)); // Header
-    root += WSIZE; // go from header to block pointer
-    PUT_ADDR(NEXTP(root), oldRoot); // Old root next pointer
-    PUT_ADDR(PREVP(root), NULL); // NULL prev pointer
-    PUT(FTRP(root), PACK(size, 0)); // Footer
+    bp += 4;
+    PUT(bp, PACK(size, 0)); // Header
+    bp += WSIZE; // go from header to block pointer
+    PUT(FTRP(bp), PACK(size, 0)); // Footer
+
+    // Add it to the free list, then coalesce and return the new block
+    insertNewBlock(bp);
+    return coalesce(bp);
+}
 
-    // Also set the oldRoot's previous pointer to point to this new root.
-    // NULL guard required in case of finding a perfect fit when only 1 free
-    // block is present (oldRoot is in that case NULL.)
-    if (oldRoot) PUT_ADDR(PREVP(oldRoot), root);
+/*
+ * Returns how many bytes to grow the heap by for a block of asize bytes that
+ * no free block fits. With GROW_FIXED that is MAX(asize, chunkSize). With
+ * GROW_ADAPTIVE it is at least that, and:
+ *  - if the heap last grew less than GROW_WINDOW mallocs ago, growth is
+ *    sustained, and the step doubles, up to 1/GROW_LIMIT of the heap, so a
+ *    growing heap takes a logarithmic number of extensions;
+ *  - but if the payload fills less than GROW_UTIL of the heap, utilization is
+ *    at risk from another large step, and the step starts over at chunkSize,
+ *    as it does when growth has paused.
+ * Growing by just asize, without the chunk, made for more extensions and
+ * more fragmentation on the test traces.
+ */
+static size_t growSize(size_t asize) {
+    size_t heap = mem_heapsize();
+    size_t limit = MAX(chunkSize, heap / GROW_LIMIT);
+
+    if (growPolicy == GROW_FIXED) return MAX(asize, chunkSize);
 
-    // Coalesce and return the newly created root
-    return coalesce(root);
+    if (growAge < GROW_WINDOW && payloadBytes >= GROW_UTIL * heap) {
+        growStep *= 2;
+        if (growStep > limit) growStep = limit;
+    } else {
+        growStep = chunkSize;
+    }
+    return MAX(asize, growStep);
+}
+
+/*
+ * Parses the size in bytes held by the environment variable "name" into
+ * *size. Returns 0 if it isn't set, 1 if it was parsed, or -1 if not.
+ */
+static int envSize(const char *name, size_t *size) {
+    char *value = getenv(name), *end;
+    unsigned long n;
+
+    if (!value) return 0;
+    n = strtoul(value, &end, 0);
+    if (end == value || *end) return -1;
+    *size = n;
+    return 1;
+}
+
+/*
+ * Applies the environment variables MM_CHUNKSIZE, MM_SPLIT_MIN, MM_FIT and
+ * MM_GROW to config, once. A variable that doesn't parse, or makes the
+ * configuration invalid, is reported and ignored.
+ */
+static void readConfig(void) {
+    mm_config_t c = config;
+    char *fit = getenv("MM_FIT");
+    char *grow = getenv("MM_GROW");
+
+    if (configRead) return;
+    configRead = 1;
+
+    if (envSize("MM_CHUNKSIZE", &c.chunk_size) < 0 || mm_set_config(&c) < 0)
+        fprintf(stderr, "mm: ignoring MM_CHUNKSIZE=%s\n", getenv("MM_CHUNKSIZE"));
+    c = config;
+    if (envSize("MM_SPLIT_MIN", &c.split_min) < 0 || mm_set_config(&c) < 0)
+        fprintf(stderr, "mm: ignoring MM_SPLIT_MIN=%s\n", getenv("MM_SPLIT_MIN"));
+    c = config;
+    if (fit) {
+        if (!strcmp(fit, "first")) c.fit_policy = FIT_FIRST;
+        else if (!strcmp(fit, "next")) c.fit_policy = FIT_NEXT;
+        else if (!strcmp(fit, "best")) c.fit_policy = FIT_BEST;
+        else fprintf(stderr, "mm: ignoring MM_FIT=%s\n", fit);
+        mm_set_config(&c);
+    }
+    if (grow) {
+        if (!strcmp(grow, "fixed")) c.grow_policy = GROW_FIXED;
+        else if (!strcmp(grow, "adaptive")) c.grow_policy = GROW_ADAPTIVE;
+        else fprintf(stderr, "mm: ignoring MM_GROW=%s\n", grow);
+        mm_set_config(&c);
+    }
+}
+
+/*
+ * Returns the configuration the next mm_init will use.
+ */
+void mm_get_config(mm_config_t *c) {
+    readConfig();
+    *c = config;
+}
+
+/*
+ * Sets the configuration the next mm_init will use. Sizes must be multiples of
+ * DSIZE, and big enough for a free block.
+ */
+int mm_set_config(const mm_config_t *c) {
+    readConfig();
+    if (c->chunk_size < 2 * DSIZE || c->chunk_size % DSIZE) return -1;
+    if (c->split_min < 2 * DSIZE || c->split_min % DSIZE) return -1;
+    if (c->fit_policy != FIT_FIRST && c->fit_policy != FIT_NEXT && c->fit_policy != FIT_BEST) return -1;
+    if (c->grow_policy != GROW_FIXED && c->grow_policy != GROW_ADAPTIVE) return -1;
+    config = *c;
+    return 0;
 }
 
 /* 
@@ -261,55 +711,103 @@ static void *extend_heap(size_t words) {
  * and free list structure and block alignment.
  */
 int mm_init(void) {
+    return mm_init_hint(0);
+}
+
+/*
+ * mm_init, for a program expected to need a heap of about heapSize bytes: the
+ * first chunk is that large, if memlib has that much, which saves the
+ * extensions that would otherwise grow the heap there.
+ */
+int mm_init_hint(size_t heapSize) {
+    void *bp;
+    size_t size;
+
+    readConfig();
+    chunkSize = config.chunk_size;
+    splitMin = config.split_min;
+    fitPolicy = config.fit_policy;
+    growPolicy = config.grow_policy;
+    growStep = chunkSize;
+    growAge = 0;
+
     // Allocate memory to initialize the empty heap.
     /* Credit: Course textbook */
-    if ((root = mem_sbrk(CHUNKSIZE)) == (void *)-1)
-        return -1;
+    size = MAX(chunkSize, (heapSize + DSIZE - 1) / DSIZE * DSIZE);
+    if ((bp = mem_sbrk(size)) == (void *)-1) {
+        size = chunkSize;
+        if ((bp = mem_sbrk(size)) == (void *)-1)
+            return -1;
+    }
+
+    root = NULL;
+    rover = NULL;
+#if INSERT_POLICY == INSERT_ADDRESS
+    regionShift = REGION_SHIFT;
+    memset(regionLast, 0, sizeof(regionLast));
+    memset(regionBits, 0, sizeof(regionBits));
+    regionFit(mem_heapsize());
+#endif
 
     // Alignment padding
-    root += 4;
-    PUT(root, PACK(CHUNKSIZE, 0)); // Header
-    root += WSIZE; // go from header to block pointer
-    PUT_ADDR(NEXTP(root), NULL); // NULL next pointer
-    PUT_ADDR(PREVP(root), NULL); // NULL prev pointer
-    PUT(FTRP(root), PACK(CHUNKSIZE, 0)); // Footer
+    bp += 4;
+    PUT(bp, PACK(size, 0)); // Header
+    bp += WSIZE; // go from header to block pointer
+    PUT(FTRP(bp), PACK(size, 0)); // Footer
+    insertNewBlock(bp);
 
     // Only used for debugging (printing of lists) 
     heap_listp = root;
 
+    payloadBytes = padBytes = slackBytes = strandedBytes = allocBlocks = 0;
+    memset(&counters, 0, sizeof(counters));
+
     return 0;
 }
 
 /*
- * Helper function used to find the first fit for a given size on the heap.
+ * Helper function used to find a fit for a given size on the heap: the first
+ * one searching from the root, or with FIT_NEXT from the rover around to it,
+ * or with FIT_BEST the smallest one.
  * Returns: a pointer to a block which is able to fit "asize" bytes as payload.
  */
-static void *find_fit(size_t asize) {
+static void *find_fit(size_t asize, size_t *probesOut) {
     // This function could be made way more concise, but its left verbose to
     // have detailed debugging information.
-    debugprint("\n******** FINDING FIT FOR %i BYTES *********\n", asize);
+    TRACE_PRINTF("\n******** FINDING FIT FOR %i BYTES *********\n", asize);
 
-    void *bp = root;
+    void *start = (fitPolicy == FIT_NEXT && rover) ? rover : root;
+    void *bp = start;
+    void *fit = NULL;
+    size_t probes = 0;
 
     while (1) {
-        debugprint("Checking %i/%i (%p) [%p / %p]\n", GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), bp, *(void **)bp, *(void **)(bp + WSIZE));
+        probes++;
+        TRACE_PRINTF("Checking %i/%i (%p) [%p / %p]\n", GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), bp, *(void **)bp, *(void **)(bp + WSIZE));
         // Check if the payload fits in this block.
         // "asize" is already adjusted to include overhead (i.e. only payload size)
-        if (GET_SIZE(HDRP(bp)) >= asize) {
-            debugprint("******* Found match *********\n");
-            break;
-        }
-
-        // If no next pointer and we couldnt fit payload in this block, we did not find a match
-        if (GET_ADDR(NEXTP(bp)) == NULL) {
-            debugprint("************ No match found ************\n");
-            return NULL;
+        // Best fit goes on looking for a smaller block, unless this one is exact.
+        if (GET_SIZE(HDRP(bp)) >= asize && (!fit || GET_SIZE(HDRP(bp)) < GET_SIZE(HDRP(fit)))) {
+            TRACE_PRINTF("******* Found match *********\n");
+            fit = bp;
+            if (fitPolicy != FIT_BEST || GET_SIZE(HDRP(bp)) == asize) break;
         }
 
+        // A search that began at the rover wraps around to the root. If we
+        // are back where we began, we have seen every block
         bp = GET_ADDR(NEXTP(bp));
+        if (!bp && start != root) bp = root;
+        if (!bp || bp == start) break;
     }
 
-    return bp;
+    STAT_INC(probes[bucketOf(probes, 1, MM_PROBE_BUCKETS)]);
+    *probesOut = probes;
+    if (!fit) {
+        TRACE_PRINTF("************ No match found ************\n");
+        return NULL;
+    }
+    if (fitPolicy == FIT_NEXT) rover = fit;
+    return fit;
 }
 
 /*
@@ -323,10 +821,10 @@ static void place(void *bp, size_t asize) {
     // Split size is the current size of the free block minus the new size that we must fit into this free block
     int splitSize = GET_SIZE(HDRP(bp)) - asize;
     // This is the boundary tag for the allocated block of the given size
-    // As we don't split on 8 or less, we must add to the size of the size
+    // As we don't split off less than splitMin, we must add to the size of the size
     // in the allocated block, else it doesn't point correctly over the
     // internal fragmentation.
-    if (splitSize == DSIZE) asize = asize + DSIZE;
+    if (splitSize < splitMin) asize = asize + splitSize;
 
     // Set the new block tags
     size_t newBoundaryTag = PACK(asize, 1);
@@ -337,10 +835,10 @@ static void place(void *bp, size_t asize) {
     void *nextp = GET_ADDR(NEXTP(bp));
 
     // If the placed block was smaller than the free block, splitSize will be
-    // greater than 0. If the split size is greater than the size of a double
-    // word, we will split (this is to reduce external fragmentation by having a
-    // lot of unusably tiny free blocks)
-    if (splitSize > DSIZE) {
+    // greater than 0. If the split size is at least splitMin (by default the
+    // smallest free block), we will split (this is to reduce external
+    // fragmentation by having a lot of unusably tiny free blocks)
+    if (splitSize >= splitMin) {
         // Boundary tag of new free block
         int freeBoundaryTag = PACK(splitSize, 0);
         // New free block is going to be placed as the physical next (NEXT_BLKP) from the previous allocated block.
@@ -348,6 +846,13 @@ static void place(void *bp, size_t asize) {
         // Update its boundary tags
         updateBlockTags(newNext, freeBoundaryTag);
 
+        // It takes the place of bp in the list (which keeps any address order)
+#if INSERT_POLICY == INSERT_ADDRESS
+        regionRemove(bp, prevp);
+        regionAdd(newNext);
+#endif
+        if (fitPolicy == FIT_NEXT && rover == bp) rover = newNext;
+
         // If previous pointer is NULL we are at the first free block (directly proceeding root)
         if (!prevp) root = newNext;
         // If not at root we must update the previous pointer's next pointer to the proper new address
@@ -361,22 +866,21 @@ static void place(void *bp, size_t asize) {
         PUT_ADDR(NEXTP(newNext), nextp);
         PUT_ADDR(PREVP(newNext), prevp);
 
-        debugprint("\n***** After place (and split): *****");
-        debugprint("\n Placed block (%p): | %i/%i | ... | %i/%i |", bp, GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), GET_SIZE(FTRP(bp)), GET_ALLOC(FTRP(bp)));
-        debugprint("\n Free block (%p): | %i/%i | ( %p ) ( %p ) ... | %i/%i |", newNext, GET_SIZE(HDRP(newNext)), GET_ALLOC(HDRP(newNext)), GET_ADDR(NEXTP(newNext)), GET_ADDR(PREVP(newNext)), GET_SIZE(FTRP(newNext)), GET_ALLOC(FTRP(newNext)));
-        debugprint("\n***** After place (and split): ***** \n\n");
+        TRACE_PRINTF("\n***** After place (and split): *****");
+        TRACE_PRINTF("\n Placed block (%p): | %i/%i | ... | %i/%i |", bp, GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), GET_SIZE(FTRP(bp)), GET_ALLOC(FTRP(bp)));
+        TRACE_PRINTF("\n Free block (%p): | %i/%i | ( %p ) ( %p ) ... | %i/%i |", newNext, GET_SIZE(HDRP(newNext)), GET_ALLOC(HDRP(newNext)), GET_ADDR(NEXTP(newNext)), GET_ADDR(PREVP(newNext)), GET_SIZE(FTRP(newNext)), GET_ALLOC(FTRP(newNext)));
+        TRACE_PRINTF("\n***** After place (and split): ***** \n\n");
     } else {
-        debugprint("\n\n ***** Found perfect fit, removing free block from list. Splitsize: %i ***** \n\n", splitSize);
+        TRACE_PRINTF("\n\n ***** Found perfect fit, removing free block from list. Splitsize: %i ***** \n\n", splitSize);
         // In this case we found the perfect fit for a payload and a free block, thus just remove the free block from the free list
         removeBlock(bp);
         // If the first allocated block is a perfect fit, removing it would
         // result in no free blocks (a NULL root), we obviously don't want that.
         // So we must extend the heap after placing it in this case.
         if (!root) {
-            extend_heap(CHUNKSIZE/WSIZE);
+            extend_heap(growSize(2 * DSIZE)/WSIZE);
         }
     }
-    mm_check();
 }
 
 /* 
@@ -386,8 +890,12 @@ static void place(void *bp, size_t asize) {
 void *mm_malloc(size_t size) {
     size_t extendsize;
     size_t asize;
+    size_t probes;
     char *bp;
 
+    STAT_INC(malloc_calls);
+    growAge++;
+
     // Ignore bad requests
     if (size == 0) return NULL;
 
@@ -395,22 +903,26 @@ void *mm_malloc(size_t size) {
     asize = ALIGN(size);
 
     // Find a fit by searching the free block list for a fit
-    if ((bp = find_fit(asize))) {
-        debugprint("\nFound fit for %i (adjusted to %i) at %i/%i (%p)\n", size, asize, GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), bp);
+    if ((bp = find_fit(asize, &probes))) {
+        TRACE_PRINTF("\nFound fit for %i (adjusted to %i) at %i/%i (%p)\n", size, asize, GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), bp);
         place(bp, asize);
-        mm_check();
+        accountAlloc(bp, size);
+        TRACE_EVENT(MMTRACE_MALLOC, size, bp, probes);
+        checkOp(bp);
         return bp;
     }
 
     /* No fit found. Get more memory and place the block */
-    extendsize = MAX(asize,CHUNKSIZE);
+    extendsize = growSize(asize);
     if (!(bp = extend_heap(extendsize/WSIZE))) {
-        printf("ERROR: No more memory!\n");
+        fprintf(stderr, "ERROR: No more memory!\n");
         return NULL;
     }
-    debugprint("\nNo fit found, but heap was extended by %i. Following is going to be placed: %i (adjusted to %i) at %i/%i (%p)\n", extendsize, size, asize, GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), bp);
+    TRACE_PRINTF("\nNo fit found, but heap was extended by %i. Following is going to be placed: %i (adjusted to %i) at %i/%i (%p)\n", extendsize, size, asize, GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), bp);
     place(bp, asize);
-    mm_check();
+    accountAlloc(bp, size);
+    TRACE_EVENT(MMTRACE_MALLOC, size, bp, probes);
+    checkOp(bp);
     return bp;
 }
 
@@ -433,22 +945,26 @@ void mm_free(void *ptr) {
     size_t nextAlloc = GET_ALLOC(HDRP(next));
     size_t prevAlloc = GET_ALLOC(HDRP(prev));
 
+    STAT_INC(free_calls);
+    TRACE_EVENT(MMTRACE_FREE, GET_SIZE(HDRP(ptr)), ptr, 0);
+    accountFree(ptr);
+
     // Case 1
     if (nextAlloc && prevAlloc && IS_IN_RANGE(next) && IS_IN_RANGE(prev)) {
-        debugprint(" \n *** Case 1 freeing of: %p (%i/%i) *** \n ", ptr, GET_SIZE(HDRP(ptr)), GET_ALLOC(HDRP(ptr)));
+        TRACE_PRINTF(" \n *** Case 1 freeing of: %p (%i/%i) *** \n ", ptr, GET_SIZE(HDRP(ptr)), GET_ALLOC(HDRP(ptr)));
         // Update the physical block tags to be unallocated
         updateBlockTags(ptr, PACK(GET_SIZE(HDRP(ptr)), 0));
 
         // Insert the new free block at the root of the list
         insertNewBlock(ptr);
-        mm_check();
+        checkOp(ptr);
         return;
     }
 
 
     // Case 2
     if (nextAlloc && !prevAlloc && IS_IN_RANGE(next) && IS_IN_RANGE(prev)) {
-        debugprint(" \n *** Case 2 freeing of: %p (%i/%i) *** \n ", ptr, GET_SIZE(HDRP(ptr)), GET_ALLOC(HDRP(ptr)));
+        TRACE_PRINTF(" \n *** Case 2 freeing of: %p (%i/%i) *** \n ", ptr, GET_SIZE(HDRP(ptr)), GET_ALLOC(HDRP(ptr)));
         // Not "re-using" coalesce function here as it unnecesarily removes the "to-be" freed block
         // Remove the predecessor block
         removeBlock(prev);
@@ -458,13 +974,13 @@ void mm_free(void *ptr) {
 
         // Insert the block (previous) at the root of the free list
         insertNewBlock(prev);
-        mm_check();
+        checkOp(prev);
         return;
     }
 
     // Case 3
     if (!nextAlloc && prevAlloc && IS_IN_RANGE(next) && IS_IN_RANGE(prev)) {
-        debugprint(" \n *** Case 3 freeing of: %p (%i/%i) *** \n ", ptr, GET_SIZE(HDRP(ptr)), GET_ALLOC(HDRP(ptr)));
+        TRACE_PRINTF(" \n *** Case 3 freeing of: %p (%i/%i) *** \n ", ptr, GET_SIZE(HDRP(ptr)), GET_ALLOC(HDRP(ptr)));
         // Not "re-using" coalesce function here as it unnecesarily removes the "to-be" freed block
         // Remove the successor block
         removeBlock(next);
@@ -474,13 +990,13 @@ void mm_free(void *ptr) {
 
         // Insert this block at the root of the free list
         insertNewBlock(ptr);
-        mm_check();
+        checkOp(ptr);
         return;
     }
 
     // Case 4
     if (!nextAlloc && !prevAlloc && IS_IN_RANGE(next) && IS_IN_RANGE(prev)) {
-        debugprint(" \n *** Case 4 freeing of: %p (%i/%i) *** \n ", ptr, GET_SIZE(HDRP(ptr)), GET_ALLOC(HDRP(ptr)));
+        TRACE_PRINTF(" \n *** Case 4 freeing of: %p (%i/%i) *** \n ", ptr, GET_SIZE(HDRP(ptr)), GET_ALLOC(HDRP(ptr)));
         // Remove the predecessor and successor blocks
         removeBlock(prev);
         removeBlock(next);
@@ -490,9 +1006,14 @@ void mm_free(void *ptr) {
 
         // Insert this block at the root of the free list
         insertNewBlock(prev);
-        mm_check();
+        checkOp(prev);
         return;
     }
+
+    // None of the cases apply to the physically last block, so it stays
+    // marked as allocated for good.
+    strandedBytes += GET_SIZE(HDRP(ptr));
+    checkOp(ptr);
 }
 
 /*
@@ -518,11 +1039,21 @@ void *mm_realloc(void *ptr, size_t size) {
     size_t asize;
     asize = ALIGN(size);
 
-    debugprint(" \n *** REALLOCATING %p (%i/%i) [payload size: %i] to %i (adjusted to %i) *** \n ", ptr, GET_SIZE(HDRP(ptr)), GET_ALLOC(HDRP(ptr)), (GET_SIZE(HDRP(ptr)) - DSIZE), size, asize);
+    TRACE_PRINTF(" \n *** REALLOCATING %p (%i/%i) [payload size: %i] to %i (adjusted to %i) *** \n ", ptr, GET_SIZE(HDRP(ptr)), GET_ALLOC(HDRP(ptr)), (GET_SIZE(HDRP(ptr)) - DSIZE), size, asize);
 
     // Ignore spurious requests
     // If the size of the current block is equal to what we want to realloc it to, ignore it.
-    if (GET_SIZE(HDRP(ptr)) == asize) return ptr;
+    STAT_INC(realloc_calls);
+    if (GET_SIZE(HDRP(ptr)) == asize) {
+        // The payload size may still have changed within the same block
+        STAT_INC(realloc_inplace);
+        accountFree(ptr);
+        updateBlockTags(ptr, PACK(asize, 1));
+        accountAlloc(ptr, size);
+        TRACE_EVENT(MMTRACE_REALLOC, size, ptr, 0);
+        checkOp(ptr);
+        return ptr;
+    }
 
     // Simple base cases by definition of realloc
     if (!ptr) return mm_malloc(size);
@@ -537,17 +1068,19 @@ void *mm_realloc(void *ptr, size_t size) {
     if (next && !GET_ALLOC(HDRP(next)) && IS_IN_RANGE(next) && asize < extendedBlockPayloadSize) {
         // Logically remove the old free block
         removeBlock(next);
+        STAT_INC(realloc_inplace);
+        accountFree(ptr);
         int splitSize = extendedBlockPayloadSize - asize;
-        // As we don't split on 8 or less, we must add to the size of the size
-        // in the allocated block, else it doesn't point correctly over the
-        // internal fragmentation. (this is identical to the place function)
-        if (splitSize == DSIZE) asize = asize + DSIZE;
+        // As we don't split off less than splitMin, we must add to the size of
+        // the size in the allocated block, else it doesn't point correctly over
+        // the internal fragmentation. (this is identical to the place function)
+        if (splitSize < splitMin) asize = asize + splitSize;
         // Extend this allocated block out
         updateBlockTags(ptr, PACK(asize, 1));
 
-        // If split size is greater than 8, then we should split a new free block in afterwards
+        // If split size is at least splitMin, then we should split a new free block in afterwards
         // Else the size of this current allocated block will not be pointing to the proper next block anymore
-        if (splitSize > 8) {
+        if (splitSize >= splitMin) {
             // This will point to where the new free block should be placed
             void *freeBlock = NEXT_BLKP(ptr);
             // Now give this free block proper tags and size
@@ -560,14 +1093,17 @@ void *mm_realloc(void *ptr, size_t size) {
             // into was the only free block, then by removing it, we might have
             // set it to NULL. In that case, obviously expand the heap.
             if (!root) {
-                extend_heap(CHUNKSIZE/WSIZE);
+                extend_heap(growSize(2 * DSIZE)/WSIZE);
             }
         }
 
-        mm_check();
+        accountAlloc(ptr, size);
+        TRACE_EVENT(MMTRACE_REALLOC, size, ptr, 0);
+        checkOp(ptr);
         return ptr;
     }
 
+    STAT_INC(realloc_copy);
     newAllocBlock = mm_malloc(size);
 
     // Simply propagate an error from malloc through this function in case of an error.
@@ -582,10 +1118,51 @@ void *mm_realloc(void *ptr, size_t size) {
 
     // Free the old free block
     mm_free(ptr);
+    TRACE_EVENT(MMTRACE_REALLOC, size, newAllocBlock, 0);
 
     return newAllocBlock;
 }
 
+/*
+ * Returns the bytes of the allocated block ptr that its owner may write: the
+ * payload and its ALIGN padding. The slack after them is left out, since it
+ * may hold the block's waste (see WASTE_BIG).
+ */
+size_t mm_usable_size(void *ptr) {
+    size_t waste = GET_WASTE(ptr);
+
+    return GET_SIZE(HDRP(ptr)) - DSIZE - (waste - waste % DSIZE);
+}
+
+/*
+ * Reports where the bytes of the heap are. The attribution of allocated
+ * blocks is kept up to date by every call; the free blocks are counted by
+ * walking the free list, which costs as much as an unsuccessful find_fit.
+ */
+void mm_stats(mm_stats_t *stats) {
+    void *bp;
+    size_t size;
+
+    *stats = counters;
+    stats->payload_bytes = payloadBytes;
+    stats->tag_bytes = allocBlocks * DSIZE;
+    stats->pad_bytes = padBytes;
+    stats->slack_bytes = slackBytes;
+    stats->stranded_bytes = strandedBytes;
+
+    stats->free_blocks = 0;
+    stats->free_bytes = 0;
+    stats->largest_free = 0;
+    for (bp = root; bp; bp = GET_ADDR(NEXTP(bp))) {
+        size = GET_SIZE(HDRP(bp));
+        stats->free_blocks++;
+        stats->free_bytes += size;
+        if (size > stats->largest_free) stats->largest_free = size;
+        if (STATS) stats->free_by_class[SIZE_CLASS(size)]++;
+    }
+}
+
+#if TRACE_LEVEL >= TRACE_VERBOSE
 /*
  * ONLY FOR DEBUGGING PURPOSES.
  * Small helper function that just fills a given char buffer with "amount" of
@@ -658,7 +1235,7 @@ static void printLists() {
 
     char titlePadding[100] = "";
     fillBufferWithChars(titlePadding, ((strlen(dashes) / 2) - 5), " ");
-    debugprint("\n\n%sFREE LIST\n%s\n%s\n%s\n%s\n%s\n%s\n%s", titlePadding, dashes, freeListBuffer, freeListAddrBuffer, dashes, freeListNextBuffer, freeListPrevBuffer, dashes);
+    TRACE_PRINTF("\n\n%sFREE LIST\n%s\n%s\n%s\n%s\n%s\n%s\n%s", titlePadding, dashes, freeListBuffer, freeListAddrBuffer, dashes, freeListNextBuffer, freeListPrevBuffer, dashes);
 
 
 
@@ -687,68 +1264,57 @@ static void printLists() {
         freeListBuffer[i] == '|' ? strcat(dashes, "+") : strcat(dashes, "-");
 
     fillBufferWithChars(titlePadding, ((strlen(dashes) / 2) - 5), " ");
-    debugprint("\n\n%sHEAP LIST\n%s\n%s\n%s", titlePadding, dashes, freeListBuffer, dashes);
+    TRACE_PRINTF("\n\n%sHEAP LIST\n%s\n%s\n%s", titlePadding, dashes, freeListBuffer, dashes);
 }
+#endif
 
 /*
- * Heap consistency checker
+ * Full heap consistency checker. Runs every CHECK_EVERY operations when
+ * HEAP_CHECK is set (see checkOp), and can be called at any time on demand.
+ * The free list is loaded into a hashed set first, so that checking the
+ * heap list against it is linear rather than O(heap x free list).
  */
-int mm_check() {
-    if (!HEAP_CHECK) return 1;
+int mm_check(void) {
     // Visually print both the free list and the heap list
+#if TRACE_LEVEL >= TRACE_VERBOSE
     if (PRINT_LISTS) printLists();
+#endif
+
+    // "Does the free list end?" A list with more entries than the heap has
+    // room for blocks must have a cycle.
+    size_t maxBlocks = mem_heapsize() / (2 * DSIZE);
+    size_t freeCount = 0;
+    void *bp;
+    for (bp = root; bp; bp = GET_ADDR(NEXTP(bp))) {
+        if (!IS_IN_RANGE(bp)) PRINT_AND_FAIL("A free list pointer points outside of the heap.");
+        if (++freeCount > maxBlocks) PRINT_AND_FAIL("The free list has a cycle.");
+    }
 
-    // Small helper macro for printing an error and returning 0.
-    #define PRINT_AND_FAIL(str) { printf(" \n ****** HEAP INCONSISTENCY FOUND: \"%s\" ******** \n ", str); return 0; }
-
-    // Check the free list for inconsistencies. Most of the code here should be
-    // self explanatory, and the strings being printed will tell what is being
-    // checked.
-    void *bp = root;
-    while (bp) {
-        void *hdr;
-        void *next;
-        void *prev;
-        void *physNext;
-        void *physPrev;
-
-        hdr = HDRP(bp);
-        // "Are there any free blocks with a size of zero?"
-        if (GET_SIZE(hdr) == 0) PRINT_AND_FAIL("A free block has a size of zero.");
-        // "Is every block in the free list marked as free?"
-        if (GET_ALLOC(hdr)) PRINT_AND_FAIL("A \"free\" block has the allocated bit set.");
-
-        // "Do the pointers in the free list point to valid free blocks?"
-        next = GET_ADDR(NEXTP(bp));
-        prev = GET_ADDR(PREVP(bp));
-        if (next && GET_ALLOC(HDRP(next))) PRINT_AND_FAIL("A free block is pointing (next) to a non-free block.");
-        if (prev && GET_ALLOC(HDRP(prev))) PRINT_AND_FAIL("A free block is pointing (prev) to a non-free block.");
-
-        // "Are there any contiguous free blocks that somehow escaped coalescing?"
-        // Make sure there is no physical next/prev free blocks from this free
-        // blocks, as that would indicate that a block has escaped coalescing.
-        physNext = NEXT_BLKP(bp);
-        physPrev = PREV_BLKP(bp);
-        if (physNext && IS_IN_RANGE(physNext) && physNext != bp && GET_ALLOC(HDRP(physNext)) == 0) PRINT_AND_FAIL("A free block has escaped coalescing, as it has a succeeding free block that could have been coalesced.");
-        if (physPrev && IS_IN_RANGE(physPrev) && physPrev != bp && GET_ALLOC(HDRP(physPrev)) == 0) PRINT_AND_FAIL("A free block has escaped coalescing, as it has a preceding free block that could have been coalesced.");
-
-
-        bp = GET_ADDR(NEXTP(bp));
+    // Check every block in the free list on its own (see checkBlock for what
+    // that entails) and remember it.
+    if (!setReset(freeCount)) PRINT_AND_FAIL("Could not map memory for the free list set.");
+    for (bp = root; bp; bp = GET_ADDR(NEXTP(bp))) {
+        if (!checkBlock(bp)) return 0;
+        if (GET_ALLOC(HDRP(bp))) PRINT_AND_FAIL("A \"free\" block has the allocated bit set.");
+        if (!setInsert(bp)) PRINT_AND_FAIL("A block is in the free list twice.");
     }
 
-    // Check the heap list for any free blocks that are not also present in the
-    // free list
+    // Walk the heap list, checking every block, and make sure that every
+    // free block in it is also present in the free list and vice versa.
+    size_t heapFree = 0;
+    size_t heapBytes = 0;
     bp = heap_listp;
     while (IS_IN_RANGE(bp)) {
+        if (!checkBlock(bp)) return 0;
         if (!GET_ALLOC(HDRP(bp))) {
-            void *freeBp = root;
-            while (freeBp && freeBp != bp) freeBp = GET_ADDR(NEXTP(freeBp));
-            if (!freeBp) PRINT_AND_FAIL("A free block was found in the heap list that is not also present in the free list.");
+            if (!setContains(bp)) PRINT_AND_FAIL("A free block was found in the heap list that is not also present in the free list.");
+            heapFree++;
         }
-
+        heapBytes += GET_SIZE(HDRP(bp));
         bp = NEXT_BLKP(bp);
     }
-
+    if (heapFree != freeCount) PRINT_AND_FAIL("The free list holds blocks that are not in the heap list.");
+    if (heapBytes != mem_heapsize()) PRINT_AND_FAIL("The block sizes do not add up to the heap size.");
 
     // Return nonzero valaue iff heap is consistent (no inconsistencies found)
     return 1;
@@ -1,9 +1,86 @@
+#ifndef __MM_H_
+#define __MM_H_
+
 #include <stdio.h>
 
 extern int mm_init (void);
+/* mm_init for a program expected to need about heap_size bytes of heap */
+extern int mm_init_hint(size_t heap_size);
 extern void *mm_malloc (size_t size);
 extern void mm_free (void *ptr);
 extern void *mm_realloc(void *ptr, size_t size);
+/* Bytes of the block at ptr, from mm_malloc, that the caller may use */
+extern size_t mm_usable_size(void *ptr);
+
+/*
+ * Size class i holds blocks of 2^(i+4) up to 2^(i+5)-1 bytes (tags
+ * included); the last class also holds everything larger. Probe bucket
+ * i counts free-list searches that looked at 2^i up to 2^(i+1)-1 blocks.
+ */
+#define MM_SIZE_CLASSES 16
+#define MM_PROBE_BUCKETS 16
+
+/*
+ * A snapshot of the heap, filled in by mm_stats. Every heap byte is
+ * attributed to exactly one of the *_bytes fields, so they sum to the
+ * heap size. Free sizes are block sizes, i.e., they include the tags.
+ *
+ * The call counters cover everything since the last mm_init. They are
+ * all zero if the allocator was built with its statistics compiled out.
+ */
+typedef struct {
+    size_t payload_bytes;  /* bytes requested by the live allocations */
+    size_t tag_bytes;      /* headers and footers of allocated blocks */
+    size_t pad_bytes;      /* alignment rounding of allocated blocks */
+    size_t slack_bytes;    /* remainders too small to split off */
+    size_t stranded_bytes; /* freed blocks never returned to the free list */
+    size_t free_bytes;     /* total size of the free blocks */
+    size_t free_blocks;    /* number of free blocks */
+    size_t largest_free;   /* size of the largest free block */
+
+    size_t malloc_calls;    /* mm_malloc calls, including via mm_realloc */
+    size_t free_calls;      /* mm_free calls, including via mm_realloc */
+    size_t realloc_calls;   /* mm_realloc calls */
+    size_t realloc_inplace; /* ... that kept the block where it was */
+    size_t realloc_copy;    /* ... that moved the payload to a new block */
+    size_t extend_calls;    /* times the heap was grown */
+    size_t extend_bytes;    /* bytes the heap was grown by */
+    size_t probes[MM_PROBE_BUCKETS];       /* free-list search lengths */
+    size_t live_by_class[MM_SIZE_CLASSES]; /* allocated blocks per class */
+    size_t free_by_class[MM_SIZE_CLASSES]; /* free blocks per class */
+} mm_stats_t;
+
+extern void mm_stats(mm_stats_t *stats);
+
+/*
+ * The tunable parameters of mm.c. They start out as its compile-time
+ * defaults, unless the environment variables MM_CHUNKSIZE, MM_SPLIT_MIN
+ * (both in bytes), MM_FIT (first, next or best) or MM_GROW (fixed or
+ * adaptive) say otherwise, and mm_set_config changes them. mm_init reads
+ * them, so a change takes effect at the next mm_init.
+ */
+#define MM_FIT_FIRST 0 /* the first block that fits */
+#define MM_FIT_NEXT 1  /* ... searching on from where the last search ended */
+#define MM_FIT_BEST 2  /* the smallest block that fits */
+
+#define MM_GROW_FIXED 0    /* grow the heap by a chunk, or the request */
+#define MM_GROW_ADAPTIVE 1 /* ... by more and more while it keeps growing
+                              and is well used */
+
+typedef struct {
+    size_t chunk_size; /* first heap size, and usual growth step */
+    size_t split_min;  /* smallest remainder split off a block as a free one */
+    int fit_policy;    /* MM_FIT_FIRST, MM_FIT_NEXT or MM_FIT_BEST */
+    int grow_policy;   /* MM_GROW_FIXED or MM_GROW_ADAPTIVE */
+} mm_config_t;
+
+extern void mm_get_config(mm_config_t *config);
+
+/* Returns 0, or -1 without changing anything if a parameter is invalid */
+extern int mm_set_config(const mm_config_t *config);
+
+/* Full heap consistency check; returns nonzero iff the heap is consistent */
+extern int mm_check(void);
 
 
 /* 
@@ -21,3 +98,4 @@ typedef struct {
 
 extern team_t team;
 
+#endif /* __MM_H_ */
@@ -0,0 +1,55 @@
+/*
+ * mm_classes.h - Size classes, generated by
+ *
+ *   mkclasses -a 8 -s 128:16 -w 50 -m 16384
+ *
+ * Do not edit; see mkclasses.c.
+ */
+#ifndef __MM_CLASSES_H_
+#define __MM_CLASSES_H_
+
+#include <stddef.h>
+
+#define MM_CLASSES 23
+
+/* Largest block size of each class but the last, which takes the rest */
+static const size_t mm_class_limit[22] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    192, 256, 384, 512, 768, 1024, 1536, 2048,
+    3072, 4096, 6144, 8192, 12288, 16384
+};
+
+/* For each g = floor(log2(size-1)): how far to shift size-1, and where
+   the result indexes mm_class_map */
+static const unsigned char mm_class_shift[64] = {
+    63, 63, 63, 63, 63, 4, 4, 6, 7, 8, 9, 10, 11, 12, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+};
+static const short mm_class_base[64] = {
+    0, 1, 2, 3, 4, 3, 3, 9, 11, 13, 15, 17,
+    19, 21, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+    35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46,
+    47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58,
+    59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70,
+    71, 72, 73, 73
+};
+static const unsigned char mm_class_map[75] = {
+    0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+    13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 22, 22, 22, 22, 22, 22,
+    22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22,
+    22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22,
+    22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22
+};
+
+/* The class of a block of size bytes */
+static inline int mm_size_class(size_t size)
+{
+    unsigned long long s = (size - 1) | 1;
+    int g = 63 - __builtin_clzll(s);
+
+    return mm_class_map[mm_class_base[g] + (int)(s >> mm_class_shift[g])];
+}
+
+#endif /* __MM_CLASSES_H_ */
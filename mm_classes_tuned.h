@@ -0,0 +1,59 @@
+/*
+ * mm_classes_tuned.h - Size classes, generated by
+ *
+ *   mkclasses -a 8 -s 128:16 -w 50 -m 16384 -n 23 -p profile.rep
+ *
+ * Do not edit; see mkclasses.c.
+ */
+#ifndef __MM_CLASSES_H_
+#define __MM_CLASSES_H_
+
+#include <stddef.h>
+
+#define MM_CLASSES 23
+
+/* Largest block size of each class but the last, which takes the rest */
+static const size_t mm_class_limit[22] = {
+    32, 40, 48, 56, 72, 80, 88, 112,
+    144, 160, 208, 272, 352, 576, 640, 704,
+    1024, 1792, 2944, 4352, 8192, 16384
+};
+
+/* For each g = floor(log2(size-1)): how far to shift size-1, and where
+   the result indexes mm_class_map */
+static const unsigned char mm_class_shift[64] = {
+    63, 63, 63, 63, 63, 3, 3, 4, 4, 6, 8, 7, 8, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+};
+static const short mm_class_base[64] = {
+    0, 1, 2, 3, 4, 1, 1, 9, 9, 33, 45, 37,
+    53, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95,
+    96, 97, 98, 99, 100, 101, 102, 103, 104, 105, 106, 107,
+    108, 109, 110, 111, 112, 113, 114, 115, 116, 117, 118, 119,
+    120, 121, 122, 123, 124, 125, 126, 127, 128, 129, 130, 131,
+    132, 133, 134, 134
+};
+static const unsigned char mm_class_map[136] = {
+    0, 0, 0, 0, 0, 1, 2, 3, 4, 4, 5, 6, 7, 7, 7, 8,
+    8, 8, 9, 10, 10, 10, 11, 11, 11, 11, 12, 12, 12, 12, 12, 13,
+    13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 14, 15, 16, 16, 16, 16,
+    16, 17, 17, 17, 18, 18, 18, 18, 18, 18, 18, 18, 19, 19, 19, 19,
+    19, 19, 19, 19, 19, 19, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20,
+    20, 20, 20, 20, 20, 21, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22,
+    22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22,
+    22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22,
+    22, 22, 22, 22, 22, 22, 22, 22
+};
+
+/* The class of a block of size bytes */
+static inline int mm_size_class(size_t size)
+{
+    unsigned long long s = (size - 1) | 1;
+    int g = 63 - __builtin_clzll(s);
+
+    return mm_class_map[mm_class_base[g] + (int)(s >> mm_class_shift[g])];
+}
+
+#endif /* __MM_CLASSES_H_ */
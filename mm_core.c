@@ -0,0 +1,36 @@
+/*
+ * mm_core.c - The mm.h functions of an instance of mm_core.h
+ *
+ * The configuration comes from the compiler's -D options, e.g.
+ *
+ *   gcc -DCORE_FIT=FIT_SEGREGATED -DCORE_FOOTERS=FOOTERS_FREE -c mm_core.c
+ *
+ * and the Makefile builds one object per configuration mdriver knows,
+ * each with the RENAME prefix it is registered under in backend.c.
+ */
+#include "mm_core.h"
+
+int mm_init(void)
+{
+    return core_init();
+}
+
+void *mm_malloc(size_t size)
+{
+    return core_malloc(size);
+}
+
+void mm_free(void *ptr)
+{
+    core_free(ptr);
+}
+
+void *mm_realloc(void *ptr, size_t size)
+{
+    return core_realloc(ptr, size);
+}
+
+int mm_check(void)
+{
+    return core_check();
+}
@@ -0,0 +1,501 @@
+/*
+ * mm_core.h - A malloc package specialized at compile time
+ *
+ * This is a complete explicit free list allocator whose design choices
+ * are macros instead of edits to the code:
+ *
+ *   CORE_WSIZE     bytes in a header or footer (4 or 8)
+ *   CORE_FIT       FIT_FIRST, FIT_NEXT or FIT_BEST on one free list, or
+ *                  FIT_SEGREGATED, first fit on one list per size class
+ *   CORE_COALESCE  COALESCE_IMMEDIATE, on every free, or COALESCE_DEFERRED,
+ *                  all of the heap at once when a search fails
+ *   CORE_FOOTERS   FOOTERS_ALL, or FOOTERS_FREE: only free blocks have a
+ *                  footer, and every header keeps the allocated bit of
+ *                  the block before it
+ *   CORE_CLASSES_H the header with the size classes (FIT_SEGREGATED only),
+ *                  "mm_classes.h" unless given; see mkclasses.c
+ *   CORE_ROUND     1 to round every block up to the largest size of its
+ *                  class, as a size class allocator does (FIT_SEGREGATED
+ *                  only; the class limits must be multiples of DSIZE)
+ *
+ * Every choice is a constant, so the compiler drops the code of those not
+ * taken and an instance makes no run-time tests on its configuration. The
+ * functions are static; a source file that includes this header gives them
+ * their mm.h names. mm_core.c is that file for mdriver, compiled once per
+ * configuration under its own RENAME prefix (see the Makefile).
+ *
+ * Blocks are laid out as in the textbook: a header with the block size
+ * and allocated bit, the payload, and a footer, between a prologue and an
+ * epilogue block. Free blocks hold their next and previous free list
+ * pointers at the start of the payload, and are inserted LIFO.
+ */
+#ifndef __MM_CORE_H_
+#define __MM_CORE_H_
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+#define FIT_FIRST 0
+#define FIT_NEXT 1
+#define FIT_BEST 2
+#define FIT_SEGREGATED 3
+
+#define COALESCE_IMMEDIATE 0
+#define COALESCE_DEFERRED 1
+
+#define FOOTERS_ALL 0
+#define FOOTERS_FREE 1
+
+#ifndef CORE_WSIZE
+#define CORE_WSIZE 4
+#endif
+#ifndef CORE_FIT
+#define CORE_FIT FIT_FIRST
+#endif
+#ifndef CORE_COALESCE
+#define CORE_COALESCE COALESCE_IMMEDIATE
+#endif
+#ifndef CORE_FOOTERS
+#define CORE_FOOTERS FOOTERS_ALL
+#endif
+#ifndef CORE_ROUND
+#define CORE_ROUND 0
+#endif
+#ifndef CORE_CLASSES_H
+#define CORE_CLASSES_H "mm_classes.h"
+#endif
+
+#include CORE_CLASSES_H
+
+#if CORE_WSIZE == 4
+typedef unsigned int core_word_t;
+#elif CORE_WSIZE == 8
+typedef unsigned long long core_word_t;
+#else
+#error "CORE_WSIZE must be 4 or 8"
+#endif
+
+/* Basic constants and macros */
+#define WSIZE CORE_WSIZE      /* header/footer size (bytes) */
+#define DSIZE (2 * WSIZE)     /* alignment of blocks (bytes) */
+#define CHUNKSIZE (1 << 12)   /* extend the heap by at least this (bytes) */
+
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+#define ROUND_UP(n, k) (((n) + (k) - 1) / (k) * (k))
+
+/* Bytes of tags in an allocated block, and the smallest block */
+#define OVERHEAD (CORE_FOOTERS == FOOTERS_ALL ? DSIZE : WSIZE)
+#define MIN_BLOCK ROUND_UP(DSIZE + 2 * sizeof(char *), DSIZE)
+
+/* Pack a size, the previous block's allocated bit and the allocated bit */
+#define PACK(size, prev_alloc, alloc) \
+    ((size) | (CORE_FOOTERS == FOOTERS_FREE ? (prev_alloc) << 1 : 0) | (alloc))
+
+/* Read and write a word at address p */
+#define GET(p) (*(core_word_t *)(p))
+#define PUT(p, val) (*(core_word_t *)(p) = (core_word_t)(val))
+
+/* Read the size and allocated fields from address p */
+#define GET_SIZE(p) ((size_t)(GET(p) & ~(core_word_t)0x7))
+#define GET_ALLOC(p) ((int)(GET(p) & 0x1))
+#define GET_PREV_ALLOC(p) ((int)((GET(p) >> 1) & 0x1))
+
+/* Given block ptr bp, compute address of its header and footer */
+#define HDRP(bp) ((char *)(bp) - WSIZE)
+#define FTRP(bp) ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)
+
+/* Given block ptr bp, compute address of next and previous blocks */
+#define NEXT_BLKP(bp) ((char *)(bp) + GET_SIZE(HDRP(bp)))
+#define PREV_BLKP(bp) ((char *)(bp) - GET_SIZE((char *)(bp) - DSIZE))
+
+/* Given free block ptr bp, its next and previous free list pointers */
+#define NEXT_FREE(bp) (((char **)(bp))[0])
+#define PREV_FREE(bp) (((char **)(bp))[1])
+
+/* One free list per size class, or just one */
+#define NUM_LISTS (CORE_FIT == FIT_SEGREGATED ? MM_CLASSES : 1)
+
+static char *heap_listp;              /* the prologue block */
+static char *free_lists[NUM_LISTS];   /* first block of each free list */
+static char *rover;                   /* FIT_NEXT: where to search next */
+static size_t deferred_bytes;         /* freed since the last coalesce_all */
+
+/*
+ * class_of - the free list for blocks of asize bytes
+ */
+static inline int class_of(size_t asize)
+{
+    return CORE_FIT == FIT_SEGREGATED ? mm_size_class(asize) : 0;
+}
+
+/*
+ * adjust - the block size for a request of size bytes
+ */
+static inline size_t adjust(size_t size)
+{
+    size_t asize = MAX(MIN_BLOCK, ROUND_UP(size + OVERHEAD, DSIZE));
+    int c;
+
+    if (CORE_FIT == FIT_SEGREGATED && CORE_ROUND) {
+	c = mm_size_class(asize);
+	if (c < MM_CLASSES - 1)
+	    asize = mm_class_limit[c];
+    }
+    return asize;
+}
+
+/*
+ * prev_alloc - is the block before bp allocated?
+ */
+static inline int prev_alloc(char *bp)
+{
+    if (CORE_FOOTERS == FOOTERS_FREE)
+	return GET_PREV_ALLOC(HDRP(bp));
+    return GET_ALLOC((char *)bp - DSIZE);
+}
+
+/*
+ * set_block - write the tags of block bp, keeping the allocated bit of
+ *     the block before it; only free blocks get a footer with FOOTERS_FREE
+ */
+static inline void set_block(char *bp, size_t size, int alloc)
+{
+    int pa = CORE_FOOTERS == FOOTERS_FREE ? GET_PREV_ALLOC(HDRP(bp)) : 0;
+
+    PUT(HDRP(bp), PACK(size, pa, alloc));
+    if (CORE_FOOTERS == FOOTERS_ALL || !alloc)
+	PUT(FTRP(bp), PACK(size, pa, alloc));
+}
+
+/*
+ * set_prev_alloc - tell block bp whether the block before it is allocated
+ */
+static inline void set_prev_alloc(char *bp, int alloc)
+{
+    if (CORE_FOOTERS == FOOTERS_FREE)
+	PUT(HDRP(bp), (GET(HDRP(bp)) & ~(core_word_t)0x2) | (alloc << 1));
+}
+
+/*
+ * insert_free - push free block bp on the list for its size
+ */
+static void insert_free(char *bp)
+{
+    char **list = &free_lists[class_of(GET_SIZE(HDRP(bp)))];
+
+    NEXT_FREE(bp) = *list;
+    PREV_FREE(bp) = NULL;
+    if (*list)
+	PREV_FREE(*list) = bp;
+    *list = bp;
+}
+
+/*
+ * remove_free - take free block bp off its list; its size must not have
+ *     changed since it was inserted
+ */
+static void remove_free(char *bp)
+{
+    if (CORE_FIT == FIT_NEXT && rover == bp)
+	rover = NEXT_FREE(bp);
+    if (PREV_FREE(bp))
+	NEXT_FREE(PREV_FREE(bp)) = NEXT_FREE(bp);
+    else
+	free_lists[class_of(GET_SIZE(HDRP(bp)))] = NEXT_FREE(bp);
+    if (NEXT_FREE(bp))
+	PREV_FREE(NEXT_FREE(bp)) = PREV_FREE(bp);
+}
+
+/*
+ * coalesce - merge free block bp, which is on no list, with the free
+ *     blocks next to it; returns the merged block, also on no list
+ */
+static char *coalesce(char *bp)
+{
+    size_t size = GET_SIZE(HDRP(bp));
+    char *next = NEXT_BLKP(bp);
+
+    if (!GET_ALLOC(HDRP(next))) {
+	remove_free(next);
+	size += GET_SIZE(HDRP(next));
+    }
+    if (!prev_alloc(bp)) {
+	bp = PREV_BLKP(bp);
+	remove_free(bp);
+	size += GET_SIZE(HDRP(bp));
+    }
+    set_block(bp, size, 0);
+    return bp;
+}
+
+/*
+ * coalesce_all - merge every run of free blocks in the heap and rebuild
+ *     the free lists from the result (COALESCE_DEFERRED)
+ */
+static void coalesce_all(void)
+{
+    char *bp, *next;
+    size_t size;
+
+    memset(free_lists, 0, sizeof(free_lists));
+    rover = NULL;
+    deferred_bytes = 0;
+    for (bp = NEXT_BLKP(heap_listp); GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
+	if (GET_ALLOC(HDRP(bp)))
+	    continue;
+	size = GET_SIZE(HDRP(bp));
+	for (next = NEXT_BLKP(bp); !GET_ALLOC(HDRP(next)); next = NEXT_BLKP(next))
+	    size += GET_SIZE(HDRP(next));
+	set_block(bp, size, 0);
+	insert_free(bp);
+    }
+}
+
+/*
+ * split - give the end of allocated block bp back as a free block, if
+ *     more than asize bytes of it leave room for one
+ */
+static void split(char *bp, size_t asize)
+{
+    size_t rest = GET_SIZE(HDRP(bp)) - asize;
+    char *fp;
+
+    if (rest < MIN_BLOCK)
+	return;
+    set_block(bp, asize, 1);
+    fp = NEXT_BLKP(bp);
+    PUT(HDRP(fp), PACK(rest, 1, 0));
+    PUT(FTRP(fp), PACK(rest, 1, 0));
+    set_prev_alloc(NEXT_BLKP(fp), 0);
+    if (CORE_COALESCE == COALESCE_IMMEDIATE)
+	fp = coalesce(fp);
+    insert_free(fp);
+}
+
+/*
+ * extend_heap - grow the heap by size bytes, a multiple of DSIZE, and
+ *     return the free block at its end
+ */
+static char *extend_heap(size_t size)
+{
+    char *bp;
+
+    if ((bp = mem_sbrk(size)) == (void *)-1)
+	return NULL;
+
+    /* The old epilogue header becomes the new block's header */
+    set_block(bp, size, 0);
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 0, 1));
+    bp = coalesce(bp);
+    insert_free(bp);
+    return bp;
+}
+
+/*
+ * find_fit - find a free block of at least asize bytes, or NULL
+ */
+static char *find_fit(size_t asize)
+{
+    char *bp, *start, *best = NULL;
+    int i;
+
+    if (CORE_FIT == FIT_SEGREGATED) {
+	for (i = class_of(asize); i < (int)NUM_LISTS; i++)
+	    for (bp = free_lists[i]; bp; bp = NEXT_FREE(bp))
+		if (GET_SIZE(HDRP(bp)) >= asize)
+		    return bp;
+	return NULL;
+    }
+
+    if (CORE_FIT == FIT_NEXT) {
+	start = rover ? rover : free_lists[0];
+	for (bp = start; bp; bp = NEXT_FREE(bp))
+	    if (GET_SIZE(HDRP(bp)) >= asize)
+		return rover = bp;
+	for (bp = free_lists[0]; bp != start; bp = NEXT_FREE(bp))
+	    if (GET_SIZE(HDRP(bp)) >= asize)
+		return rover = bp;
+	return NULL;
+    }
+
+    if (CORE_FIT == FIT_BEST) {
+	for (bp = free_lists[0]; bp; bp = NEXT_FREE(bp)) {
+	    if (GET_SIZE(HDRP(bp)) < asize)
+		continue;
+	    if (!best || GET_SIZE(HDRP(bp)) < GET_SIZE(HDRP(best)))
+		best = bp;
+	    if (GET_SIZE(HDRP(bp)) == asize)
+		break;
+	}
+	return best;
+    }
+
+    for (bp = free_lists[0]; bp; bp = NEXT_FREE(bp))
+	if (GET_SIZE(HDRP(bp)) >= asize)
+	    return bp;
+    return NULL;
+}
+
+/*
+ * place - allocate asize bytes of free block bp
+ */
+static void place(char *bp, size_t asize)
+{
+    remove_free(bp);
+    set_block(bp, GET_SIZE(HDRP(bp)), 1);
+    set_prev_alloc(NEXT_BLKP(bp), 1);
+    split(bp, asize);
+}
+
+/*****************************************************************
+ * The mm.h functions, under core_ names
+ ****************************************************************/
+
+static int core_init(void)
+{
+    if ((heap_listp = mem_sbrk(4 * WSIZE)) == (void *)-1)
+	return -1;
+    PUT(heap_listp, 0);                                /* alignment padding */
+    PUT(heap_listp + WSIZE, PACK(DSIZE, 1, 1));        /* prologue header */
+    PUT(heap_listp + 2 * WSIZE, PACK(DSIZE, 1, 1));    /* prologue footer */
+    PUT(heap_listp + 3 * WSIZE, PACK(0, 1, 1));        /* epilogue header */
+    heap_listp += 2 * WSIZE;
+
+    memset(free_lists, 0, sizeof(free_lists));
+    rover = NULL;
+    deferred_bytes = 0;
+    if (extend_heap(CHUNKSIZE) == NULL)
+	return -1;
+    return 0;
+}
+
+static void *core_malloc(size_t size)
+{
+    size_t asize;
+    char *bp;
+
+    if (size == 0)
+	return NULL;
+    asize = adjust(size);
+
+    bp = find_fit(asize);
+    if (!bp && CORE_COALESCE == COALESCE_DEFERRED && deferred_bytes >= asize) {
+	coalesce_all();
+	bp = find_fit(asize);
+    }
+    if (!bp && (bp = extend_heap(MAX(asize, CHUNKSIZE))) == NULL)
+	return NULL;
+    place(bp, asize);
+    return bp;
+}
+
+static void core_free(void *ptr)
+{
+    char *bp = ptr;
+
+    if (bp == NULL)
+	return;
+    set_block(bp, GET_SIZE(HDRP(bp)), 0);
+    set_prev_alloc(NEXT_BLKP(bp), 0);
+    if (CORE_COALESCE == COALESCE_IMMEDIATE)
+	bp = coalesce(bp);
+    else
+	deferred_bytes += GET_SIZE(HDRP(bp));
+    insert_free(bp);
+}
+
+static void *core_realloc(void *ptr, size_t size)
+{
+    char *bp = ptr, *next, *newp;
+    size_t asize, old;
+
+    if (ptr == NULL)
+	return core_malloc(size);
+    if (size == 0) {
+	core_free(ptr);
+	return NULL;
+    }
+    asize = adjust(size);
+    old = GET_SIZE(HDRP(bp));
+
+    /* Shrink in place, or grow into a free block after this one */
+    if (asize <= old) {
+	split(bp, asize);
+	return ptr;
+    }
+    next = NEXT_BLKP(bp);
+    if (!GET_ALLOC(HDRP(next)) && old + GET_SIZE(HDRP(next)) >= asize) {
+	remove_free(next);
+	set_block(bp, old + GET_SIZE(HDRP(next)), 1);
+	set_prev_alloc(NEXT_BLKP(bp), 1);
+	split(bp, asize);
+	return ptr;
+    }
+
+    if ((newp = core_malloc(size)) == NULL)
+	return NULL;
+    memcpy(newp, ptr, MIN(size, old - OVERHEAD));
+    core_free(ptr);
+    return newp;
+}
+
+/* Small helper macro for reporting an inconsistency and failing */
+#define CHECK(cond, msg) do { \
+    if (!(cond)) { printf("mm_check: %s (block %p)\n", msg, (void *)bp); return 0; } \
+} while (0)
+
+/*
+ * core_check - walk the heap and the free lists; returns nonzero iff
+ *     they are consistent
+ */
+static int core_check(void)
+{
+    char *bp, *prev;
+    size_t heap_free = 0, list_free = 0;
+    int i, last_alloc = 1;
+
+    bp = heap_listp;
+    CHECK(GET_SIZE(HDRP(bp)) == DSIZE && GET_ALLOC(HDRP(bp)), "bad prologue");
+    for (bp = NEXT_BLKP(bp); GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
+	CHECK((size_t)bp % DSIZE == 0, "block not aligned");
+	CHECK(GET_SIZE(HDRP(bp)) >= MIN_BLOCK, "block smaller than the minimum");
+	CHECK(prev_alloc(bp) == last_alloc, "wrong allocated bit of the block before");
+	if (CORE_FOOTERS == FOOTERS_ALL || !GET_ALLOC(HDRP(bp)))
+	    CHECK(GET_SIZE(HDRP(bp)) == GET_SIZE(FTRP(bp)) &&
+		  GET_ALLOC(HDRP(bp)) == GET_ALLOC(FTRP(bp)),
+		  "header and footer differ");
+	if (CORE_COALESCE == COALESCE_IMMEDIATE)
+	    CHECK(last_alloc || GET_ALLOC(HDRP(bp)), "free blocks escaped coalescing");
+	if (!GET_ALLOC(HDRP(bp)))
+	    heap_free++;
+	last_alloc = GET_ALLOC(HDRP(bp));
+    }
+    CHECK(GET_ALLOC(HDRP(bp)) && prev_alloc(bp) == last_alloc, "bad epilogue");
+
+    for (i = 0; i < (int)NUM_LISTS; i++) {
+	prev = NULL;
+	for (bp = free_lists[i]; bp; prev = bp, bp = NEXT_FREE(bp)) {
+	    CHECK(bp > (char *)mem_heap_lo() && bp < (char *)mem_heap_hi(),
+		  "free list points outside the heap");
+	    CHECK(!GET_ALLOC(HDRP(bp)), "allocated block on a free list");
+	    CHECK(PREV_FREE(bp) == prev, "free list links disagree");
+	    CHECK(class_of(GET_SIZE(HDRP(bp))) == i, "free block on the wrong list");
+	    if (CORE_FIT == FIT_SEGREGATED)
+		CHECK((i == MM_CLASSES - 1 || GET_SIZE(HDRP(bp)) <= mm_class_limit[i]) &&
+		      (i == 0 || GET_SIZE(HDRP(bp)) > mm_class_limit[i - 1]),
+		      "free block outside the sizes of its class");
+	    list_free++;
+	}
+    }
+    bp = NULL;
+    CHECK(heap_free == list_free, "free blocks missing from the free lists");
+    bp = rover;
+    CHECK(!bp || !GET_ALLOC(HDRP(bp)), "rover on an allocated block");
+    return 1;
+}
+
+#endif /* __MM_CORE_H_ */
@@ -19,6 +19,7 @@
 
 #include "mm.h"
 #include "memlib.h"
+#include "mmtrace.h"
 
 team_t team = {
     /* Team name */
@@ -33,14 +34,11 @@ team_t team = {
     ""
 };
 
-#define DEBUG 1
-#define HEAPCHECK 1
+#define HEAPCHECK 0
 #define WSIZE 4
 #define DSIZE 8
 #define CHUNKSIZE 4096
 
-#define debugprint(format, args...) if (DEBUG) printf(format, ## args)
-
 #define MAX(x, y) (x > y ? x : y)
 
 #define PACK(size, alloc) (size | alloc)
@@ -62,7 +60,7 @@ team_t team = {
 
 
 
-void *heap_listp;
+static void *heap_listp;
 
 static void *coalesce(void *bp)
 {
@@ -136,20 +134,20 @@ int mm_init(void) {
 
 static void *find_fit(size_t asize) {
     // TODO: Make this more concise (no need for this much debug)
-    debugprint("\n******** FINDING FIT FOR %i BYTES *********\n", asize);
+    TRACE_PRINTF("\n******** FINDING FIT FOR %i BYTES *********\n", asize);
 
     void *bp = (char *)heap_listp;
 
     while (1) {
-        debugprint("Checking %i/%i (%p)\n", GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), bp);
+        TRACE_PRINTF("Checking %i/%i (%p)\n", GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), bp);
 
         if (GET_SIZE(HDRP(bp)) == 0) {
-            debugprint("************ No match found ************\n");
+            TRACE_PRINTF("************ No match found ************\n");
             return NULL;
         }
 
         if (!GET_ALLOC(HDRP(bp)) && GET_PAYLOAD_SIZE(bp) >= asize) {
-            debugprint("******* Found match *********\n");
+            TRACE_PRINTF("******* Found match *********\n");
             break;
         }
 
@@ -204,7 +202,7 @@ void *mm_malloc(size_t size) {
 
     /* Search the free list for a fit */
     if ((bp = find_fit(asize)) != NULL) {
-        debugprint("\nFound fit for %i (adjusted to %i) at %i/%i (%p)\n", size, asize, GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), bp);
+        TRACE_PRINTF("\nFound fit for %i (adjusted to %i) at %i/%i (%p)\n", size, asize, GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), bp);
         place(bp, asize);
         return bp;
     }
@@ -215,7 +213,7 @@ void *mm_malloc(size_t size) {
         printf("No more memory... ERR\n");
         return NULL;
     }
-    debugprint("\nNo fit found, but heap was extended by %i. Following was placed: %i (adjusted to %i) at %i/%i (%p)\n", extendsize, size, asize, GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), bp);
+    TRACE_PRINTF("\nNo fit found, but heap was extended by %i. Following was placed: %i (adjusted to %i) at %i/%i (%p)\n", extendsize, size, asize, GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), bp);
     place(bp, asize);
     return bp;
 }
@@ -277,16 +275,16 @@ void *mm_realloc(void *ptr, size_t size) {
 
 int mm_check() {
     if (!HEAPCHECK) return 1;
-    debugprint("\n\n---------- HEAP CHECK ----------\n\n");
+    TRACE_PRINTF("\n\n---------- HEAP CHECK ----------\n\n");
 
     char *bp = heap_listp;
     while (GET_SIZE(HDRP(bp)) != 0) {
-        debugprint("| %i/%i | ... | %i/%i ", GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), GET_SIZE(FTRP(bp)), GET_ALLOC(FTRP(bp)));
+        TRACE_PRINTF("| %i/%i | ... | %i/%i ", GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)), GET_SIZE(FTRP(bp)), GET_ALLOC(FTRP(bp)));
         bp = NEXT_BLKP(bp);
     }
-    debugprint("| %i/%i |", GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)));
+    TRACE_PRINTF("| %i/%i |", GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)));
 
-    debugprint("\n\n---------- HEAP CHECK ----------\n\n");
+    TRACE_PRINTF("\n\n---------- HEAP CHECK ----------\n\n");
     return 1;
 }
 
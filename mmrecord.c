@@ -0,0 +1,657 @@
+/*
+ * mmrecord.c - Record the malloc requests of a live process as a trace
+ *
+ * Built as libmmrecord.so ("make libmmrecord.so"), this wraps the C
+ * library's malloc, free, realloc and calloc and writes every request to
+ * a tracefile that mdriver can replay:
+ *
+ *   unix> MMRECORD_OUT=ls.rep LD_PRELOAD=./libmmrecord.so ls -l
+ *   unix> mdriver -f ls.rep
+ *
+ * Environment variables:
+ *
+ *   MMRECORD_OUT      the tracefile, in which %p stands for the process
+ *                     id (default mmrecord.%p.rep)
+ *   MMRECORD_THREADS  if set, tag the requests with thread ids
+ *   MMRECORD_BINARY   if set, keep the binary log, <tracefile>.bin
+ *
+ * Every process that loads the library records itself, so give programs
+ * that start others (shells, compiler drivers, launcher scripts) a %p.
+ * Without one, the last process to start gets the file.
+ *
+ * Every block returned by malloc, calloc or realloc is given the next
+ * dense id, which a realloc keeps. Frees and reallocs of blocks we never
+ * saw (from before the library was loaded, or from posix_memalign and
+ * friends) are left out.
+ *
+ * The wrappers do little more than update the pointer-to-id map and
+ * append a record to a buffer of the calling thread. The map is guarded
+ * by a mutex, under which each request also takes the next sequence
+ * number, so the sequence numbers order the requests the way the map saw
+ * them. The buffers are lock-free single-producer rings that a background
+ * thread drains into the binary log, a file mapped into memory in which
+ * each record is stored at its sequence number. Whatever prefix of the
+ * log is complete is written out as tracefile lines as it goes; at exit
+ * the last requests are written and the header, which was written with
+ * blank fields, is filled in.
+ *
+ * With MMRECORD_THREADS, a "t <tid>" line precedes every request made by
+ * a different thread than the one before it. Threads are numbered from 0
+ * in the order of their first request.
+ *
+ * The binary log is an array of record_t in sequence order. A type of 0
+ * marks a request that was never logged (e.g. a thread was interrupted
+ * halfway through a wrapper at exit).
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#define EXPORT __attribute__((visibility("default")))
+
+#define RING 4096              /* records per thread buffer (power of 2) */
+#define FLUSH_USEC 1000        /* how often the flusher drains the buffers */
+#define MAP_MIN 4096           /* initial slots of the pointer map */
+#define LOG_MIN (1 << 16)      /* initial records in the binary log */
+#define BOOT_BYTES (64*1024)   /* for dlsym, before the real malloc is known */
+#define HEADER_FIELD 12        /* width of each blank header field */
+#define MAXPATH 1024
+
+/* One request in the binary log */
+typedef struct {
+    unsigned id;
+    unsigned size;             /* 0 for frees */
+    unsigned tid;
+    unsigned type;             /* 'a', 'r', 'f', or 0 if missing */
+} record_t;
+
+/* A thread's buffer of records that the flusher hasn't taken yet */
+typedef struct buffer {
+    struct buffer *next;       /* list of all buffers */
+    unsigned tid;
+    unsigned long head;        /* written by the thread */
+    unsigned long tail;        /* written by the flusher */
+    struct {
+	unsigned long seq;
+	record_t rec;
+    } ring[RING];
+} buffer_t;
+
+/* A slot of the pointer-to-id map */
+typedef struct {
+    void *ptr;                 /* EMPTY, TOMBSTONE or a live block */
+    unsigned id;
+    unsigned size;
+} slot_t;
+
+#define EMPTY ((void *)0)
+#define TOMBSTONE ((void *)1)
+
+/* The real functions */
+static void *(*real_malloc)(size_t);
+static void (*real_free)(void *);
+static void *(*real_realloc)(void *, size_t);
+static void *(*real_calloc)(size_t, size_t);
+
+static int recording = 0;      /* set once the flusher is running */
+static pid_t recording_pid;    /* forked children don't record */
+static int tag_threads = 0;
+
+/* Set in the recorder's own code, whose allocations aren't recorded */
+static __thread int busy __attribute__((tls_model("initial-exec")));
+static __thread buffer_t *my_buffer __attribute__((tls_model("initial-exec")));
+
+static char boot[BOOT_BYTES] __attribute__((aligned(16)));
+static size_t boot_used = 0;
+static int resolving = 0;
+
+/* The map and the counters, guarded by map_lock */
+static pthread_mutex_t map_lock = PTHREAD_MUTEX_INITIALIZER;
+static slot_t *map;
+static size_t map_slots, map_used; /* used counts tombstones too */
+static unsigned next_id = 0;
+static unsigned long next_seq = 0;
+static unsigned long live_bytes = 0, peak_bytes = 0;
+
+/* The buffers, pushed onto the list by their threads */
+static buffer_t *buffers = NULL;
+static unsigned next_tid = 0;
+
+/* Flusher state; only the flusher (and the exit handler after it has
+   stopped) touches these */
+static pthread_t flusher;
+static volatile int stopping = 0;
+static int log_fd = -1;
+static record_t *log_map;
+static unsigned long log_records;   /* capacity of log_map */
+static unsigned long written = 0;   /* records written out as text */
+static unsigned num_ids = 0;        /* 1 + the largest id written */
+static unsigned last_tid = (unsigned)-1;
+static FILE *out;
+static char out_path[MAXPATH];
+
+/*****************************************************************
+ * Memory for the recorder itself comes straight from mmap
+ ****************************************************************/
+
+static void *map_pages(size_t bytes)
+{
+    void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (p == MAP_FAILED) ? NULL : p;
+}
+
+/*
+ * boot_malloc - serve dlsym's allocations while the real functions
+ *     are being looked up. These blocks are never freed.
+ */
+static void *boot_malloc(size_t size)
+{
+    char *p = boot + boot_used;
+
+    size = (size + 15) & ~(size_t)15;
+    if (size > BOOT_BYTES - boot_used)
+	return NULL;
+    boot_used += size;
+    return p;
+}
+
+static int in_boot(void *ptr)
+{
+    return (char *)ptr >= boot && (char *)ptr < boot + BOOT_BYTES;
+}
+
+/*****************************************************************
+ * The pointer-to-id map; called with map_lock held
+ ****************************************************************/
+
+static size_t hash(void *ptr)
+{
+    size_t h = (size_t)ptr >> 4;
+
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    return h;
+}
+
+static slot_t *find_slot(void *ptr)
+{
+    size_t i;
+
+    for (i = hash(ptr) & (map_slots - 1); map[i].ptr != EMPTY;
+	 i = (i + 1) & (map_slots - 1))
+	if (map[i].ptr == ptr)
+	    return &map[i];
+    return NULL;
+}
+
+static void map_insert(void *ptr, unsigned id, unsigned size);
+
+/*
+ * map_grow - rehash into a table a quarter full of the live blocks
+ */
+static void map_grow(void)
+{
+    slot_t *old = map;
+    size_t i, old_slots = map_slots;
+    size_t live = 0;
+
+    for (i = 0; i < old_slots; i++)
+	if (old[i].ptr != EMPTY && old[i].ptr != TOMBSTONE)
+	    live++;
+    for (map_slots = MAP_MIN; map_slots < 4 * live; map_slots *= 2)
+	;
+    if ((map = map_pages(map_slots * sizeof(slot_t))) == NULL) {
+	map = old;
+	map_slots = old_slots;
+	recording = 0; /* out of memory; stop rather than record garbage */
+	return;
+    }
+    map_used = 0;
+    for (i = 0; i < old_slots; i++)
+	if (old[i].ptr != EMPTY && old[i].ptr != TOMBSTONE)
+	    map_insert(old[i].ptr, old[i].id, old[i].size);
+    munmap(old, old_slots * sizeof(slot_t));
+}
+
+static void map_insert(void *ptr, unsigned id, unsigned size)
+{
+    size_t i;
+
+    if (2 * (map_used + 1) > map_slots)
+	map_grow();
+    for (i = hash(ptr) & (map_slots - 1);
+	 map[i].ptr != EMPTY && map[i].ptr != TOMBSTONE;
+	 i = (i + 1) & (map_slots - 1))
+	;
+    if (map[i].ptr == EMPTY)
+	map_used++;
+    map[i].ptr = ptr;
+    map[i].id = id;
+    map[i].size = size;
+}
+
+/*****************************************************************
+ * Logging a request
+ ****************************************************************/
+
+/*
+ * get_buffer - the calling thread's buffer, created on its first request
+ */
+static buffer_t *get_buffer(void)
+{
+    buffer_t *b = my_buffer;
+
+    if (b != NULL)
+	return b;
+    if ((b = map_pages(sizeof(buffer_t))) == NULL)
+	return NULL;
+    b->tid = __sync_fetch_and_add(&next_tid, 1);
+    do
+	b->next = buffers;
+    while (!__sync_bool_compare_and_swap(&buffers, b->next, b));
+    return my_buffer = b;
+}
+
+/*
+ * push - append a record with sequence number seq to the thread's buffer,
+ *     waiting for the flusher if the buffer is full
+ */
+static void push(buffer_t *b, unsigned long seq, unsigned type,
+		 unsigned id, unsigned size)
+{
+    unsigned long h = b->head;
+
+    while (h - __atomic_load_n(&b->tail, __ATOMIC_ACQUIRE) >= RING)
+	sched_yield();
+    b->ring[h & (RING - 1)].seq = seq;
+    b->ring[h & (RING - 1)].rec.id = id;
+    b->ring[h & (RING - 1)].rec.size = size;
+    b->ring[h & (RING - 1)].rec.tid = b->tid;
+    b->ring[h & (RING - 1)].rec.type = type;
+    __atomic_store_n(&b->head, h + 1, __ATOMIC_RELEASE);
+}
+
+static int should_record(void)
+{
+    return recording && !busy && getpid() == recording_pid;
+}
+
+/*
+ * record_alloc - log that ptr was returned for a new block of size bytes
+ */
+static void record_alloc(void *ptr, size_t size)
+{
+    buffer_t *b = get_buffer();
+    unsigned long seq;
+    unsigned id;
+
+    if (b == NULL)
+	return;
+    pthread_mutex_lock(&map_lock);
+    id = next_id++;
+    map_insert(ptr, id, size);
+    seq = next_seq++;
+    live_bytes += size;
+    if (live_bytes > peak_bytes)
+	peak_bytes = live_bytes;
+    pthread_mutex_unlock(&map_lock);
+    push(b, seq, 'a', id, size);
+}
+
+/*
+ * record_free - log that ptr is about to be freed. This must happen
+ *     before the real free, so that no other thread can have been given
+ *     the same address yet.
+ */
+static void record_free(void *ptr)
+{
+    buffer_t *b = get_buffer();
+    unsigned long seq;
+    slot_t *s;
+    unsigned id;
+
+    if (b == NULL)
+	return;
+    pthread_mutex_lock(&map_lock);
+    if ((s = find_slot(ptr)) == NULL) {
+	pthread_mutex_unlock(&map_lock);
+	return;
+    }
+    id = s->id;
+    live_bytes -= s->size;
+    s->ptr = TOMBSTONE;
+    seq = next_seq++;
+    pthread_mutex_unlock(&map_lock);
+    push(b, seq, 'f', id, 0);
+}
+
+/*****************************************************************
+ * The flusher
+ ****************************************************************/
+
+/*
+ * log_reserve - make room for record seq in the binary log
+ */
+static int log_reserve(unsigned long seq)
+{
+    unsigned long records = log_records;
+
+    if (seq < log_records)
+	return 1;
+    while (records <= seq)
+	records *= 2;
+    if (ftruncate(log_fd, records * sizeof(record_t)) < 0)
+	return 0;
+    munmap(log_map, log_records * sizeof(record_t));
+    log_map = mmap(NULL, records * sizeof(record_t), PROT_READ | PROT_WRITE,
+		   MAP_SHARED, log_fd, 0);
+    if (log_map == MAP_FAILED)
+	return 0;
+    log_records = records;
+    return 1;
+}
+
+/*
+ * write_ready - write out the complete prefix of the log as trace lines
+ */
+static void write_ready(void)
+{
+    record_t *r;
+
+    while (written < log_records && log_map[written].type != 0) {
+	r = &log_map[written++];
+	if (tag_threads && r->tid != last_tid) {
+	    fprintf(out, "t %u\n", r->tid);
+	    last_tid = r->tid;
+	}
+	if (r->type == 'f')
+	    fprintf(out, "f %u\n", r->id);
+	else {
+	    fprintf(out, "%c %u %u\n", r->type, r->id, r->size);
+	    if (r->id >= num_ids)
+		num_ids = r->id + 1;
+	}
+    }
+}
+
+/*
+ * drain - move the records in every buffer into the log
+ */
+static void drain(void)
+{
+    buffer_t *b;
+    unsigned long t, h;
+
+    for (b = buffers; b != NULL; b = b->next) {
+	h = __atomic_load_n(&b->head, __ATOMIC_ACQUIRE);
+	for (t = b->tail; t < h; t++) {
+	    if (!log_reserve(b->ring[t & (RING - 1)].seq)) {
+		recording = 0;
+		return;
+	    }
+	    log_map[b->ring[t & (RING - 1)].seq] = b->ring[t & (RING - 1)].rec;
+	}
+	__atomic_store_n(&b->tail, h, __ATOMIC_RELEASE);
+    }
+    write_ready();
+}
+
+static void *flush_loop(void *arg)
+{
+    busy = 1;
+    while (!stopping) {
+	drain();
+	usleep(FLUSH_USEC);
+    }
+    return NULL;
+}
+
+/*****************************************************************
+ * Starting and stopping
+ ****************************************************************/
+
+static void stop_in_child(void)
+{
+    recording = 0;
+}
+
+/*
+ * make_path - expand %p in the pattern into path
+ */
+static void make_path(char *path, char *pattern, pid_t pid)
+{
+    char *end = path + MAXPATH - 16; /* room for a pid */
+
+    for (; *pattern && path < end; pattern++) {
+	if (pattern[0] == '%' && pattern[1] == 'p') {
+	    path += sprintf(path, "%d", (int)pid);
+	    pattern++;
+	}
+	else
+	    *path++ = *pattern;
+    }
+    *path = '\0';
+}
+
+/*
+ * start - look up the real functions and start recording. Runs from the
+ *     library's constructor, or from the first wrapper called before it.
+ */
+static void start(void)
+{
+    static int started = 0;
+    char log_path[MAXPATH + 8];
+    char *env;
+    int i;
+
+    if (started)
+	return;
+    started = 1;
+
+    resolving = 1;
+    real_malloc = dlsym(RTLD_NEXT, "malloc");
+    real_free = dlsym(RTLD_NEXT, "free");
+    real_realloc = dlsym(RTLD_NEXT, "realloc");
+    real_calloc = dlsym(RTLD_NEXT, "calloc");
+    resolving = 0;
+    if (!real_malloc || !real_free || !real_realloc || !real_calloc)
+	abort();
+
+    busy = 1;
+    recording_pid = getpid();
+    tag_threads = getenv("MMRECORD_THREADS") != NULL;
+    if ((env = getenv("MMRECORD_OUT")) == NULL)
+	env = "mmrecord.%p.rep";
+    make_path(out_path, env, recording_pid);
+    snprintf(log_path, sizeof(log_path), "%s.bin", out_path);
+
+    /* New files, so that another process recording to the same names
+       can't truncate them under us */
+    unlink(out_path);
+    unlink(log_path);
+
+    map_slots = MAP_MIN;
+    log_records = LOG_MIN;
+    if ((map = map_pages(map_slots * sizeof(slot_t))) == NULL ||
+	(out = fopen(out_path, "w")) == NULL ||
+	(log_fd = open(log_path, O_RDWR | O_CREAT | O_EXCL, 0644)) < 0 ||
+	ftruncate(log_fd, log_records * sizeof(record_t)) < 0 ||
+	(log_map = mmap(NULL, log_records * sizeof(record_t),
+			PROT_READ | PROT_WRITE, MAP_SHARED, log_fd, 0))
+	== MAP_FAILED) {
+	fprintf(stderr, "mmrecord: could not create %s or %s\n",
+		out_path, log_path);
+	busy = 0;
+	return;
+    }
+    if (getenv("MMRECORD_BINARY") == NULL)
+	unlink(log_path);
+
+    /* The header is filled in at exit */
+    for (i = 0; i < 4; i++)
+	fprintf(out, "%*s\n", HEADER_FIELD, "");
+
+    pthread_atfork(NULL, NULL, stop_in_child);
+    if (pthread_create(&flusher, NULL, flush_loop, NULL) == 0)
+	recording = 1;
+    busy = 0;
+}
+
+/*
+ * finish - write out the rest of the trace and fill in its header
+ */
+static void finish(void)
+{
+    unsigned long num_ops;
+    char field[HEADER_FIELD + 1];
+
+    if (!recording || getpid() != recording_pid)
+	return;
+    busy = 1;
+    stopping = 1;
+    pthread_join(flusher, NULL);
+    drain();
+    recording = 0;
+
+    /* Requests that other threads were halfway through are dropped */
+    num_ops = written;
+    pthread_mutex_lock(&map_lock);
+    if (next_seq > written)
+	fprintf(stderr, "mmrecord: %lu unfinished requests dropped\n",
+		next_seq - written);
+    fflush(out);
+    fseek(out, 0, SEEK_SET);
+    snprintf(field, sizeof(field), "%lu", peak_bytes);
+    fprintf(out, "%-*s\n", HEADER_FIELD, field);
+    snprintf(field, sizeof(field), "%u", num_ids);
+    fprintf(out, "%-*s\n", HEADER_FIELD, field);
+    snprintf(field, sizeof(field), "%lu", num_ops);
+    fprintf(out, "%-*s\n", HEADER_FIELD, field);
+    fprintf(out, "%-*d\n", HEADER_FIELD, 1);
+    fclose(out);
+    pthread_mutex_unlock(&map_lock);
+
+    if (ftruncate(log_fd, num_ops * sizeof(record_t)) < 0)
+	fprintf(stderr, "mmrecord: could not truncate the binary log\n");
+    close(log_fd);
+}
+
+__attribute__((constructor)) static void mmrecord_init(void)
+{
+    start();
+}
+
+__attribute__((destructor)) static void mmrecord_fini(void)
+{
+    finish();
+}
+
+/*****************************************************************
+ * The wrappers
+ ****************************************************************/
+
+EXPORT void *malloc(size_t size)
+{
+    void *p;
+
+    if (resolving)
+	return boot_malloc(size);
+    start();
+    p = real_malloc(size);
+    if (p != NULL && should_record())
+	record_alloc(p, size);
+    return p;
+}
+
+EXPORT void *calloc(size_t nmemb, size_t size)
+{
+    void *p;
+
+    if (resolving) {
+	/* boot is never reused, so it is still zero */
+	if (size && nmemb > (size_t)-1 / size)
+	    return NULL;
+	return boot_malloc(nmemb * size);
+    }
+    start();
+    p = real_calloc(nmemb, size);
+    if (p != NULL && should_record())
+	record_alloc(p, nmemb * size);
+    return p;
+}
+
+EXPORT void free(void *ptr)
+{
+    if (ptr == NULL || in_boot(ptr))
+	return;
+    start();
+    if (should_record())
+	record_free(ptr);
+    real_free(ptr);
+}
+
+EXPORT void *realloc(void *ptr, size_t size)
+{
+    buffer_t *b;
+    unsigned long seq;
+    slot_t *s;
+    unsigned id = 0, old_size = 0;
+    int known = 0;
+    void *p;
+
+    if (ptr == NULL)
+	return malloc(size);
+    if (in_boot(ptr)) {
+	/* Only dlsym's own blocks live here; copy what we can */
+	if ((p = malloc(size)) != NULL)
+	    memcpy(p, ptr, size < (size_t)(boot + BOOT_BYTES - (char *)ptr) ?
+		   size : (size_t)(boot + BOOT_BYTES - (char *)ptr));
+	return p;
+    }
+    start();
+    if (!should_record() || (b = get_buffer()) == NULL)
+	return real_realloc(ptr, size);
+    if (size == 0) {
+	record_free(ptr);
+	return real_realloc(ptr, size);
+    }
+
+    /* Take the block out of the map before the address can be reused */
+    pthread_mutex_lock(&map_lock);
+    if ((s = find_slot(ptr)) != NULL) {
+	known = 1;
+	id = s->id;
+	old_size = s->size;
+	s->ptr = TOMBSTONE;
+    }
+    pthread_mutex_unlock(&map_lock);
+
+    p = real_realloc(ptr, size);
+
+    pthread_mutex_lock(&map_lock);
+    if (p == NULL) {
+	if (known)
+	    map_insert(ptr, id, old_size); /* the old block is still there */
+	pthread_mutex_unlock(&map_lock);
+	return NULL;
+    }
+    if (!known)
+	id = next_id++;
+    map_insert(p, id, size);
+    seq = next_seq++;
+    live_bytes += size - old_size;
+    if (live_bytes > peak_bytes)
+	peak_bytes = live_bytes;
+    pthread_mutex_unlock(&map_lock);
+    push(b, seq, known ? 'r' : 'a', id, size);
+    return p;
+}
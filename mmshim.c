@@ -0,0 +1,312 @@
+/*
+ * mmshim.c - Run real programs on the mm malloc package
+ *
+ * Built as libmmshim.so ("make libmmshim.so"), this replaces the C
+ * library's malloc family with mm.c, so that any program can be run on
+ * it with LD_PRELOAD:
+ *
+ *   unix> LD_PRELOAD=./libmmshim.so /usr/bin/time -v <program>
+ *
+ * The heap comes from memlib built with MEMLIB_MMAP, i.e., from address
+ * space reserved with mmap that grows as mm.c calls mem_sbrk. mm.c is not
+ * thread safe, so every call takes one lock. mm.c (or something it calls,
+ * like printf) may itself call malloc while the lock is held, most of all
+ * while the heap is set up on the first call; such nested calls are served
+ * from a small static bootstrap arena instead, and their blocks are never
+ * reused.
+ *
+ * Alignments beyond ALIGNMENT are served by allocating extra bytes and
+ * returning an aligned pointer inside the block. The word before such a
+ * pointer holds its offset from the start of the block. mm.c keeps a
+ * header word with the allocated bit set before every payload, so the
+ * clear low bit tells the two apart in free.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "mm.h"
+#include "memlib.h"
+#include "config.h"
+
+/* The functions that replace libc's; everything else stays hidden */
+#define EXPORT __attribute__((visibility("default")))
+
+#define BOOT_BYTES (64*1024) /* size of the bootstrap arena */
+#define BOOT_ALIGN 16        /* alignment of bootstrap blocks */
+
+/* The word before a payload: mm.c's header, or an aligned offset */
+#define WORD_BEFORE(p) (((size_t *)(p))[-1])
+#define IS_OFFSET(p) (!(WORD_BEFORE(p) & 0x1))
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static int initialized = 0;
+
+/* Set while this thread is inside mm.c; a nested call must not wait for
+   the lock it already holds. initial-exec keeps the first access from
+   allocating. */
+static __thread int busy __attribute__((tls_model("initial-exec")));
+
+static char boot[BOOT_BYTES] __attribute__((aligned(BOOT_ALIGN)));
+static size_t boot_used = 0;
+
+/*****************************************************************
+ * Bootstrap arena. Each block is preceded by BOOT_ALIGN bytes that
+ * hold its size, so that realloc can copy it.
+ ****************************************************************/
+
+static int in_boot(void *ptr)
+{
+    return (char *)ptr >= boot && (char *)ptr < boot + BOOT_BYTES;
+}
+
+static void *boot_malloc(size_t size)
+{
+    char *p;
+    size_t need;
+
+    if (size > BOOT_BYTES)
+	return NULL;
+    need = BOOT_ALIGN + ((size + BOOT_ALIGN - 1) & ~(size_t)(BOOT_ALIGN - 1));
+    p = boot + __sync_fetch_and_add(&boot_used, need);
+    if (p + need > boot + BOOT_BYTES)
+	return NULL;
+    *(size_t *)p = size;
+    return p + BOOT_ALIGN;
+}
+
+static size_t boot_size(void *ptr)
+{
+    return *(size_t *)((char *)ptr - BOOT_ALIGN);
+}
+
+/*****************************************************************
+ * Entering and leaving mm.c
+ ****************************************************************/
+
+static void prepare_fork(void)
+{
+    pthread_mutex_lock(&lock);
+}
+
+static void finish_fork(void)
+{
+    pthread_mutex_unlock(&lock);
+}
+
+/*
+ * enter - take the lock and set up the heap on the first call. Returns
+ *     0 if the caller is nested inside mm.c and must use the bootstrap
+ *     arena instead.
+ */
+static int enter(void)
+{
+    if (busy)
+	return 0;
+    pthread_mutex_lock(&lock);
+    busy = 1;
+    if (!initialized) {
+	mem_init();
+	if (mm_init() < 0)
+	    abort();
+	/* Keep a child from inheriting the lock in a locked state */
+	pthread_atfork(prepare_fork, finish_fork, finish_fork);
+	initialized = 1;
+    }
+    return 1;
+}
+
+static void leave(void)
+{
+    busy = 0;
+    pthread_mutex_unlock(&lock);
+}
+
+/*
+ * in_heap - is ptr a payload in mm.c's heap? Blocks from elsewhere
+ *     (the bootstrap arena, or the dynamic linker before we were loaded)
+ *     are never given to mm_free.
+ */
+static int in_heap(void *ptr)
+{
+    return initialized &&
+	(char *)ptr > (char *)mem_heap_lo() &&
+	(char *)ptr <= (char *)mem_heap_hi();
+}
+
+/*
+ * block_of - the payload of mm.c's block that holds ptr
+ */
+static void *block_of(void *ptr)
+{
+    return IS_OFFSET(ptr) ? (char *)ptr - WORD_BEFORE(ptr) : ptr;
+}
+
+/*
+ * usable - bytes that can be used from ptr on
+ */
+static size_t usable(void *ptr)
+{
+    void *bp = block_of(ptr);
+
+    return mm_usable_size(bp) - ((char *)ptr - (char *)bp);
+}
+
+/*
+ * shim_memalign - allocate size bytes aligned to alignment, a power of two
+ */
+static void *shim_memalign(size_t alignment, size_t size)
+{
+    char *p, *aligned;
+
+    if (alignment <= ALIGNMENT)
+	return malloc(size);
+    if (alignment > MMAP_HEAP || size > MMAP_HEAP - alignment) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    if ((p = malloc(size + alignment)) == NULL)
+	return NULL;
+    aligned = (char *)(((size_t)p + alignment - 1) & ~(alignment - 1));
+    if (aligned == p)
+	return p;
+
+    /* Bootstrap blocks are never freed, but realloc needs their size */
+    if (in_boot(p))
+	*(size_t *)(aligned - BOOT_ALIGN) = size;
+    else
+	WORD_BEFORE(aligned) = aligned - p;
+    return aligned;
+}
+
+/*****************************************************************
+ * The malloc family
+ ****************************************************************/
+
+EXPORT void *malloc(size_t size)
+{
+    void *p;
+
+    if (size > MMAP_HEAP) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    if (!enter())
+	return boot_malloc(size);
+    p = mm_malloc(size ? size : 1);
+    leave();
+    if (p == NULL)
+	errno = ENOMEM;
+    return p;
+}
+
+EXPORT void free(void *ptr)
+{
+    if (ptr == NULL || !in_heap(ptr))
+	return;
+    if (!enter())
+	return; /* leak it rather than wait on ourselves */
+    mm_free(block_of(ptr));
+    leave();
+}
+
+EXPORT void *calloc(size_t nmemb, size_t size)
+{
+    void *p;
+
+    if (size && nmemb > (size_t)-1 / size) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    if ((p = malloc(nmemb * size)) != NULL)
+	memset(p, 0, nmemb * size);
+    return p;
+}
+
+EXPORT void *realloc(void *ptr, size_t size)
+{
+    void *p;
+    size_t old;
+
+    if (ptr == NULL)
+	return malloc(size);
+    if (size == 0) {
+	free(ptr);
+	return NULL;
+    }
+    if (size > MMAP_HEAP) {
+	errno = ENOMEM;
+	return NULL;
+    }
+
+    /* mm_realloc only knows blocks that start at ptr */
+    if (in_heap(ptr) && !IS_OFFSET(ptr) && enter()) {
+	p = mm_realloc(ptr, size);
+	leave();
+	if (p == NULL)
+	    errno = ENOMEM;
+	return p;
+    }
+
+    if (in_boot(ptr))
+	old = boot_size(ptr);
+    else if (in_heap(ptr))
+	old = usable(ptr);
+    else
+	return NULL; /* not ours, and its size is unknown */
+    if ((p = malloc(size)) == NULL)
+	return NULL;
+    memcpy(p, ptr, old < size ? old : size);
+    free(ptr);
+    return p;
+}
+
+EXPORT int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *p;
+
+    if (alignment % sizeof(void *) || (alignment & (alignment - 1)))
+	return EINVAL;
+    if ((p = shim_memalign(alignment, size)) == NULL)
+	return ENOMEM;
+    *memptr = p;
+    return 0;
+}
+
+EXPORT void *aligned_alloc(size_t alignment, size_t size)
+{
+    if (alignment == 0 || (alignment & (alignment - 1))) {
+	errno = EINVAL;
+	return NULL;
+    }
+    return shim_memalign(alignment, size);
+}
+
+EXPORT void *memalign(size_t alignment, size_t size)
+{
+    return aligned_alloc(alignment, size);
+}
+
+EXPORT void *valloc(size_t size)
+{
+    return shim_memalign(mem_pagesize(), size);
+}
+
+EXPORT void *pvalloc(size_t size)
+{
+    size_t page = mem_pagesize();
+
+    return shim_memalign(page, (size + page - 1) & ~(page - 1));
+}
+
+EXPORT size_t malloc_usable_size(void *ptr)
+{
+    if (ptr == NULL)
+	return 0;
+    if (in_boot(ptr))
+	return boot_size(ptr);
+    if (!in_heap(ptr))
+	return 0;
+    return usable(ptr);
+}
@@ -0,0 +1,93 @@
+/*
+ * mmtrace.c - Ring buffer of allocator events
+ *
+ * See mmtrace.h. The buffer is shared by everything linked into the
+ * program; only allocators built with TRACE_LEVEL >= TRACE_EVENTS add
+ * events to it.
+ */
+#include <unistd.h>
+
+#include "mmtrace.h"
+
+static mmtrace_event_t ring[MMTRACE_EVENTS];
+static unsigned long next_seq = 0; /* sequence number of the next event */
+
+static const char *op_names[] = {"malloc", "free", "realloc", "extend"};
+
+/*
+ * mmtrace_event - add an event to the ring buffer
+ */
+void mmtrace_event(int op, size_t size, void *addr, unsigned probes)
+{
+    mmtrace_event_t *e = &ring[next_seq & (MMTRACE_EVENTS - 1)];
+
+    e->seq = next_seq++;
+    e->op = op;
+    e->size = size;
+    e->addr = addr;
+    e->probes = probes;
+}
+
+/*
+ * put_num - append n to buf in the given base, returning the new end.
+ *     printf is not async-signal-safe, so mmtrace_dump formats by hand.
+ */
+static char *put_num(char *buf, unsigned long n, unsigned base)
+{
+    char digits[32];
+    int i = 0;
+
+    do {
+	digits[i++] = "0123456789abcdef"[n % base];
+	n /= base;
+    } while (n);
+    while (i > 0)
+	*buf++ = digits[--i];
+    return buf;
+}
+
+static char *put_str(char *buf, const char *s)
+{
+    while (*s)
+	*buf++ = *s++;
+    return buf;
+}
+
+/*
+ * mmtrace_dump - write the buffered events to fd, oldest first, as
+ *     "seq op size addr probes" lines
+ */
+void mmtrace_dump(int fd)
+{
+    char line[128], *p;
+    unsigned long seq;
+    unsigned long first = 0;
+    mmtrace_event_t *e;
+
+    if (next_seq > MMTRACE_EVENTS)
+	first = next_seq - MMTRACE_EVENTS;
+
+    p = put_str(line, "mmtrace: ");
+    p = put_num(p, next_seq - first, 10);
+    p = put_str(p, " of ");
+    p = put_num(p, next_seq, 10);
+    p = put_str(p, " events (seq op size addr probes)\n");
+    if (write(fd, line, p - line) < 0)
+	return;
+
+    for (seq = first; seq < next_seq; seq++) {
+	e = &ring[seq & (MMTRACE_EVENTS - 1)];
+	p = put_num(line, e->seq, 10);
+	*p++ = ' ';
+	p = put_str(p, op_names[e->op]);
+	*p++ = ' ';
+	p = put_num(p, e->size, 10);
+	p = put_str(p, " 0x");
+	p = put_num(p, (unsigned long) e->addr, 16);
+	*p++ = ' ';
+	p = put_num(p, e->probes, 10);
+	*p++ = '\n';
+	if (write(fd, line, p - line) < 0)
+	    return;
+    }
+}
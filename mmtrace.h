@@ -0,0 +1,61 @@
+/*
+ * mmtrace.h - Build-time tracing for the malloc packages
+ *
+ * Each allocator source file picks its trace level at compile time with
+ * -DTRACE_LEVEL=n (make TRACE=n):
+ *
+ *   0  TRACE_OFF      nothing; every trace macro compiles to nothing
+ *   1  TRACE_EVENTS   record each request in a ring buffer of events
+ *   2  TRACE_VERBOSE  also print the step-by-step messages (TRACE_PRINTF)
+ *
+ * The ring buffer holds the last MMTRACE_EVENTS requests in binary form
+ * (op, size, address, free-list probes), which costs a few stores per
+ * request. mmtrace_dump writes it out using only write(2), so it can be
+ * called from a signal handler after the allocator has crashed.
+ */
+#ifndef __MMTRACE_H_
+#define __MMTRACE_H_
+
+#include <stddef.h>
+
+#define TRACE_OFF     0
+#define TRACE_EVENTS  1
+#define TRACE_VERBOSE 2
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL TRACE_OFF
+#endif
+
+#define MMTRACE_EVENTS 4096 /* events kept in the ring (a power of two) */
+
+/* The requests that are logged */
+enum {MMTRACE_MALLOC, MMTRACE_FREE, MMTRACE_REALLOC, MMTRACE_EXTEND};
+
+/* One logged request */
+typedef struct {
+    unsigned long seq;   /* number of the request, counting from 0 */
+    int op;              /* MMTRACE_* */
+    size_t size;         /* requested bytes (block size for frees) */
+    void *addr;          /* block returned or freed */
+    unsigned probes;     /* free blocks looked at to serve it */
+} mmtrace_event_t;
+
+/* Add an event to the ring buffer, overwriting the oldest */
+void mmtrace_event(int op, size_t size, void *addr, unsigned probes);
+
+/* Write the buffered events, oldest first, to file descriptor fd */
+void mmtrace_dump(int fd);
+
+#if TRACE_LEVEL >= TRACE_EVENTS
+#define TRACE_EVENT(op, size, addr, probes) mmtrace_event(op, size, addr, probes)
+#else
+#define TRACE_EVENT(op, size, addr, probes) ((void) 0)
+#endif
+
+#if TRACE_LEVEL >= TRACE_VERBOSE
+#define TRACE_PRINTF(...) printf(__VA_ARGS__)
+#else
+#define TRACE_PRINTF(...) ((void) 0)
+#endif
+
+#endif /* __MMTRACE_H_ */
@@ -0,0 +1,356 @@
+/*
+ * mmtune.c - Search mm.c's run-time parameters for the best trade-offs
+ *     between space utilization and throughput
+ *
+ * Runs mdriver once for each combination of the chunk sizes, split
+ * minimums, fit policies and growth policies given, passing them through
+ * the environment (MM_CHUNKSIZE, MM_SPLIT_MIN, MM_FIT and MM_GROW, see
+ * mm.h), and reads the util and Kops of each run from mdriver's --csv
+ * results. As in mdriver's performance index, util is the average over
+ * the traces and Kops the total ops over the total time. Up to -j runs go
+ * at once, each in a worker process of its own.
+ *
+ * Every configuration is listed, the best util first, and the ones on
+ * the Pareto frontier (that no other one beats on util without losing
+ * on Kops) are marked with a '*'.
+ *
+ * Whatever follows the options is passed on to mdriver, e.g. the traces:
+ *
+ *   mmtune -j 4 -c 1024,4096 -p first,best -- -t traces/
+ *
+ * Runs that share the machine slow each other down, so with -j above 1
+ * the Kops are only comparable with each other, and then only with a
+ * CPU for each worker.
+ *
+ * Usage: mmtune [-m mdriver] [-A allocator] [-c sizes] [-s sizes]
+ *               [-p policies] [-g policies] [-j workers] [-- mdriver args...]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+/* Misc */
+#define MAXVALUES    16   /* most values of each parameter */
+#define MAXARGS     256   /* most mdriver arguments */
+#define MAXLINE    1024   /* longest line of a CSV file */
+
+/* Defaults */
+#define MDRIVER      "./mdriver"
+#define ALLOCATOR    "mm"
+#define CHUNK_SIZES  "1024,4096,16384,65536"
+#define SPLIT_MINS   "16,32,64,128"
+#define FIT_POLICIES "first,next,best"
+#define GROW_POLICIES "fixed,adaptive"
+
+/* One configuration, and its results once its run is done */
+typedef struct {
+    char *chunk_size;
+    char *split_min;
+    char *fit;
+    char *grow;
+    pid_t pid;          /* the worker running it, or 0 */
+    char csv[32];       /* the file the worker writes its results to */
+    int done;
+    int valid;          /* all traces ran correctly */
+    double util;        /* average util over the traces */
+    double kops;        /* total ops / total secs / 1000 */
+    int frontier;       /* on the Pareto frontier */
+} config_t;
+
+/* Function prototypes */
+static void usage(void);
+static void app_error(char *msg);
+
+/*
+ * split_list - split the comma-separated list s in place into values,
+ *     returning their number
+ */
+static int split_list(char *s, char **values, char *what)
+{
+    int n = 0;
+    char *value;
+
+    for (value = strtok(s, ","); value != NULL; value = strtok(NULL, ",")) {
+        if (n == MAXVALUES) {
+            fprintf(stderr, "mmtune: more than %d %s\n", MAXVALUES, what);
+            exit(1);
+        }
+        values[n++] = value;
+    }
+    if (n == 0) {
+        fprintf(stderr, "mmtune: no %s given\n", what);
+        exit(1);
+    }
+    return n;
+}
+
+/*
+ * start - run mdriver on config c in a worker process
+ */
+static void start(config_t *c, char **args, int nargs)
+{
+    int fd;
+
+    strcpy(c->csv, "/tmp/mmtune.XXXXXX");
+    if ((fd = mkstemp(c->csv)) < 0)
+        app_error("can't create a temporary file");
+    close(fd);
+    args[nargs - 1] = c->csv;   /* the argument of --csv */
+
+    if ((c->pid = fork()) < 0)
+        app_error("fork failed");
+    if (c->pid == 0) {
+        /* Only mdriver's CSV file is wanted, and its errors, such as
+           mm.c ignoring a parameter it can't use */
+        if ((fd = open("/dev/null", O_WRONLY)) >= 0)
+            dup2(fd, STDOUT_FILENO);
+        setenv("MM_CHUNKSIZE", c->chunk_size, 1);
+        setenv("MM_SPLIT_MIN", c->split_min, 1);
+        setenv("MM_FIT", c->fit, 1);
+        setenv("MM_GROW", c->grow, 1);
+        execv(args[0], args);
+        _exit(127);
+    }
+}
+
+/*
+ * finish - read the results of config c from its CSV file, given the
+ *     exit status of its worker
+ */
+static void finish(config_t *c, int status, char *allocator)
+{
+    FILE *fp;
+    char line[MAXLINE], *field;
+    int col, col_alloc = -1, col_valid = -1, col_ops = -1, col_secs = -1;
+    int col_util = -1, header = 1, traces = 0, valid = 0;
+    int alloc_ok, row_valid;
+    double ops = 0, secs = 0, util = 0, row_ops, row_secs, row_util;
+
+    c->done = 1;
+    c->pid = 0;
+    c->valid = 0;
+    if ((fp = fopen(c->csv, "r")) != NULL) {
+        while (fgets(line, MAXLINE, fp) != NULL) {
+            line[strcspn(line, "\r\n")] = '\0';
+            alloc_ok = row_valid = 0;
+            row_ops = row_secs = row_util = 0;
+            col = 0;
+            for (field = strtok(line, ","); field != NULL;
+                 field = strtok(NULL, ","), col++) {
+                if (header) {
+                    if (!strcmp(field, "allocator")) col_alloc = col;
+                    else if (!strcmp(field, "valid")) col_valid = col;
+                    else if (!strcmp(field, "ops")) col_ops = col;
+                    else if (!strcmp(field, "secs")) col_secs = col;
+                    else if (!strcmp(field, "util")) col_util = col;
+                }
+                else if (col == col_alloc)
+                    alloc_ok = !strcmp(field, allocator);
+                else if (col == col_valid)
+                    row_valid = atoi(field);
+                else if (col == col_ops)
+                    row_ops = atof(field);
+                else if (col == col_secs)
+                    row_secs = atof(field);
+                else if (col == col_util)
+                    row_util = atof(field);
+            }
+            if (header) {
+                header = 0;
+                continue;
+            }
+            if (!alloc_ok)
+                continue;
+            traces++;
+            valid += row_valid;
+            ops += row_ops;
+            secs += row_secs;
+            util += row_util;
+        }
+        fclose(fp);
+    }
+    unlink(c->csv);
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127 ||
+        col_util < 0 || traces == 0 || valid < traces || secs <= 0)
+        return;
+    c->valid = 1;
+    c->util = util / traces;
+    c->kops = ops / secs / 1e3;
+}
+
+/*
+ * by_util - qsort order of the configurations: valid ones first, by
+ *     util and then Kops, best first
+ */
+static int by_util(const void *a, const void *b)
+{
+    const config_t *x = a, *y = b;
+
+    if (x->valid != y->valid)
+        return y->valid - x->valid;
+    if (x->util != y->util)
+        return x->util < y->util ? 1 : -1;
+    if (x->kops != y->kops)
+        return x->kops < y->kops ? 1 : -1;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    char *mdriver = MDRIVER, *allocator = ALLOCATOR;
+    char chunk_list[MAXLINE] = CHUNK_SIZES, split_list_s[MAXLINE] = SPLIT_MINS;
+    char fit_list[MAXLINE] = FIT_POLICIES, grow_list[MAXLINE] = GROW_POLICIES;
+    char *chunks[MAXVALUES], *splits[MAXVALUES], *fits[MAXVALUES];
+    char *grows[MAXVALUES], *args[MAXARGS];
+    int nchunks, nsplits, nfits, ngrows, nconfigs, nargs, jobs = 1;
+    int running = 0, c, i, j, l, m, k, status, next;
+    double best_kops;
+    config_t *configs;
+    pid_t pid;
+
+    while ((c = getopt(argc, argv, "m:A:c:s:p:g:j:h")) != EOF) {
+        switch (c) {
+        case 'm': /* The mdriver to run */
+            mdriver = optarg;
+            break;
+        case 'A': /* The mm.c package to tune */
+            allocator = optarg;
+            break;
+        case 'c': /* Chunk sizes */
+            snprintf(chunk_list, MAXLINE, "%s", optarg);
+            break;
+        case 's': /* Split minimums */
+            snprintf(split_list_s, MAXLINE, "%s", optarg);
+            break;
+        case 'p': /* Fit policies */
+            snprintf(fit_list, MAXLINE, "%s", optarg);
+            break;
+        case 'g': /* Growth policies */
+            snprintf(grow_list, MAXLINE, "%s", optarg);
+            break;
+        case 'j': /* Workers, 0 for one per CPU */
+            jobs = atoi(optarg);
+            if (jobs < 1)
+                jobs = sysconf(_SC_NPROCESSORS_ONLN);
+            if (jobs < 1)
+                jobs = 1;
+            break;
+        case 'h':
+            usage();
+            exit(0);
+        default:
+            usage();
+            exit(1);
+        }
+    }
+    nchunks = split_list(chunk_list, chunks, "chunk sizes");
+    nsplits = split_list(split_list_s, splits, "split minimums");
+    nfits = split_list(fit_list, fits, "fit policies");
+    ngrows = split_list(grow_list, grows, "growth policies");
+
+    /* mdriver -a -A allocator [args...] --csv file */
+    nargs = 0;
+    args[nargs++] = mdriver;
+    args[nargs++] = "-a";
+    args[nargs++] = "-A";
+    args[nargs++] = allocator;
+    for (i = optind; i < argc; i++) {
+        if (nargs >= MAXARGS - 3)
+            app_error("too many mdriver arguments");
+        args[nargs++] = argv[i];
+    }
+    args[nargs++] = "--csv";
+    args[nargs++] = NULL;       /* filled in by start */
+    args[nargs] = NULL;
+
+    nconfigs = nchunks * nsplits * nfits * ngrows;
+    if ((configs = calloc(nconfigs, sizeof(config_t))) == NULL)
+        app_error("out of memory");
+    k = 0;
+    for (i = 0; i < nchunks; i++)
+        for (j = 0; j < nsplits; j++)
+            for (l = 0; l < nfits; l++)
+                for (m = 0; m < ngrows; m++) {
+                    configs[k].chunk_size = chunks[i];
+                    configs[k].split_min = splits[j];
+                    configs[k].fit = fits[l];
+                    configs[k].grow = grows[m];
+                    k++;
+                }
+
+    /* Run them all, jobs at a time */
+    fprintf(stderr, "mmtune: %d configurations of %s, %d at a time\n",
+            nconfigs, allocator, jobs);
+    next = 0;
+    while (next < nconfigs || running > 0) {
+        if (next < nconfigs && running < jobs) {
+            start(&configs[next++], args, nargs);
+            running++;
+            continue;
+        }
+        if ((pid = wait(&status)) < 0)
+            app_error("wait failed");
+        for (k = 0; k < nconfigs; k++)
+            if (configs[k].pid == pid) {
+                finish(&configs[k], status, allocator);
+                running--;
+                break;
+            }
+    }
+
+    /*
+     * In util order, a valid configuration is on the frontier iff it
+     * has more Kops than every one before it
+     */
+    qsort(configs, nconfigs, sizeof(config_t), by_util);
+    best_kops = -1;
+    for (k = 0; k < nconfigs && configs[k].valid; k++)
+        if (configs[k].kops > best_kops) {
+            configs[k].frontier = 1;
+            best_kops = configs[k].kops;
+        }
+
+    printf("%-2s%10s%10s%7s%10s%7s%10s\n", "", "chunk", "split", "fit",
+           "grow", "util", "Kops");
+    for (k = 0; k < nconfigs; k++) {
+        printf("%-2s%10s%10s%7s%10s", configs[k].frontier ? "*" : "",
+               configs[k].chunk_size, configs[k].split_min, configs[k].fit,
+               configs[k].grow);
+        if (configs[k].valid)
+            printf("%6.1f%%%10.0f\n", configs[k].util * 100, configs[k].kops);
+        else
+            printf("%7s%10s\n", "-", "-");
+    }
+    exit(0);
+}
+
+/*
+ * app_error - Report an error and exit
+ */
+static void app_error(char *msg)
+{
+    fprintf(stderr, "mmtune: %s\n", msg);
+    exit(1);
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mmtune [-h] [-m <mdriver>] [-A <allocator>] [-c <sizes>] [-s <sizes>]\n");
+    fprintf(stderr, "              [-p <policies>] [-g <policies>] [-j <n>] [-- <mdriver args>...]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h              Print this message.\n");
+    fprintf(stderr, "\t-m <mdriver>    The mdriver to run (default %s).\n", MDRIVER);
+    fprintf(stderr, "\t-A <allocator>  The mm.c package to tune (default %s).\n", ALLOCATOR);
+    fprintf(stderr, "\t-c <sizes>      Chunk sizes to try (default %s).\n", CHUNK_SIZES);
+    fprintf(stderr, "\t-s <sizes>      Split minimums to try (default %s).\n", SPLIT_MINS);
+    fprintf(stderr, "\t-p <policies>   Fit policies to try (default %s).\n", FIT_POLICIES);
+    fprintf(stderr, "\t-g <policies>   Growth policies to try (default %s).\n", GROW_POLICIES);
+    fprintf(stderr, "\t-j <n>          Run up to <n> configurations at once (0: one per CPU).\n");
+}
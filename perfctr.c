@@ -0,0 +1,89 @@
+/*
+ * perfctr.c - Count hardware events in a function with perf_event_open
+ *
+ * Each event gets a counter of its own, opened for the calling thread
+ * in user mode only. If the processor has fewer counters than events,
+ * the kernel takes turns, and the counts are scaled up by the share of
+ * the time each one was counting.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perfctr.h"
+
+char *perfctr_names[NUM_PERFCTRS] = {"L1D", "LLC", "dTLB"};
+
+/* Read misses of a cache, in the encoding of PERF_TYPE_HW_CACHE */
+#define CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | \
+     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static struct {
+    int type;
+    unsigned long long config;
+} events[NUM_PERFCTRS] = {
+    {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB)},
+};
+
+/* What read returns with the read_format below */
+typedef struct {
+    unsigned long long value;
+    unsigned long long time_enabled;
+    unsigned long long time_running;
+} reading_t;
+
+/*
+ * open_counter - open a disabled counter for event i, or return -1
+ */
+static int open_counter(int i)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[i].type;
+    attr.config = events[i].config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | 
+	PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int perfctr_count(perfctr_test_funct f, void *argp, 
+		  double counts[NUM_PERFCTRS])
+{
+    int fds[NUM_PERFCTRS];
+    reading_t r;
+    int i, counted = 0;
+
+    for (i = 0; i < NUM_PERFCTRS; i++)
+	fds[i] = open_counter(i);
+
+    for (i = 0; i < NUM_PERFCTRS; i++)
+	if (fds[i] >= 0)
+	    ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    f(argp);
+    for (i = 0; i < NUM_PERFCTRS; i++)
+	if (fds[i] >= 0)
+	    ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+    for (i = 0; i < NUM_PERFCTRS; i++) {
+	counts[i] = -1;
+	if (fds[i] < 0)
+	    continue;
+	if (read(fds[i], &r, sizeof(r)) == sizeof(r) && r.time_running > 0) {
+	    counts[i] = (double)r.value * r.time_enabled / r.time_running;
+	    counted++;
+	}
+	close(fds[i]);
+    }
+    return counted;
+}
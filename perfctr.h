@@ -0,0 +1,27 @@
+/*
+ * perfctr.h - Count hardware events in a function with perf_event_open
+ */
+#ifndef __PERFCTR_H_
+#define __PERFCTR_H_
+
+typedef void (*perfctr_test_funct)(void *);
+
+/* The events counted */
+enum {
+    PERFCTR_L1D,    /* L1 data cache read misses */
+    PERFCTR_LLC,    /* last level cache misses */
+    PERFCTR_DTLB,   /* data TLB read misses */
+    NUM_PERFCTRS
+};
+
+/* Short names of the events, for column headers */
+extern char *perfctr_names[NUM_PERFCTRS];
+
+/* Run f(argp) once, counting the events in user mode. Sets counts[i]
+   to the count of event i, or to -1 if it can't be counted here (no
+   such event, or perf_event_paranoid forbids it). Returns the number
+   of events that were counted. */
+int perfctr_count(perfctr_test_funct f, void *argp, 
+		  double counts[NUM_PERFCTRS]);
+
+#endif /* __PERFCTR_H_ */
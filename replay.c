@@ -0,0 +1,213 @@
+/*
+ * replay.c - Multithreaded replay of a tracefile
+ *
+ * See replay.h. Before the threads start, each request is given the
+ * index of the request it has to wait for (the previous one on the same
+ * block, if another thread made it), and each thread the list of its own
+ * requests. A thread marks every request done when it has returned; the
+ * release/acquire pair on that mark also hands the block pointer, which
+ * lives in trace->blocks, from one thread to the next.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "memlib.h"
+#include "replay.h"
+
+/* Shared by the replay threads */
+typedef struct {
+    backend_t *b;
+    trace_t *trace;
+    int *wait_for;             /* request to wait for, or -1 */
+    char *done;                /* set when a request has returned */
+    pthread_mutex_t lock;      /* taken around calls if !b->thread_safe */
+    pthread_barrier_t start;
+    volatile int failed;
+} replay_t;
+
+/* One replay thread */
+typedef struct {
+    replay_t *r;
+    int *ops;                  /* indices of its requests, in order */
+    int num_ops;
+    thread_stats_t *stats;
+} worker_t;
+
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * run_op - make request i of the trace; returns 0 if the package failed
+ */
+static int run_op(replay_t *r, int i)
+{
+    traceop_t *op = &r->trace->ops[i];
+    char **blocks = r->trace->blocks;
+    char *p;
+    int ok = 1;
+
+    if (!r->b->thread_safe)
+	pthread_mutex_lock(&r->lock);
+    switch (op->type) {
+    case ALLOC:
+	if ((p = r->b->malloc(op->size)) == NULL)
+	    ok = 0;
+	blocks[op->index] = p;
+	break;
+    case REALLOC:
+	if ((p = r->b->realloc(blocks[op->index], op->size)) == NULL)
+	    ok = 0;
+	blocks[op->index] = p;
+	break;
+    case FREE:
+	r->b->free(blocks[op->index]);
+	break;
+    }
+    if (!r->b->thread_safe)
+	pthread_mutex_unlock(&r->lock);
+    return ok;
+}
+
+static void *worker(void *arg)
+{
+    worker_t *w = (worker_t *)arg;
+    replay_t *r = w->r;
+    thread_stats_t *st = w->stats;
+    double start, ns;
+    int i, k, d, bucket;
+
+    pthread_barrier_wait(&r->start);
+    for (k = 0; k < w->num_ops && !r->failed; k++) {
+	i = w->ops[k];
+	if ((d = r->wait_for[i]) >= 0) {
+	    while (!__atomic_load_n(&r->done[d], __ATOMIC_ACQUIRE)) {
+		if (r->failed)
+		    return NULL;
+		sched_yield();
+	    }
+	}
+
+	start = now_ns();
+	if (!run_op(r, i))
+	    r->failed = 1;
+	ns = now_ns() - start;
+	__atomic_store_n(&r->done[i], 1, __ATOMIC_RELEASE);
+
+	st->ops++;
+	st->secs += ns / 1e9;
+	if (ns / 1e3 > st->max_usecs)
+	    st->max_usecs = ns / 1e3;
+	for (bucket = 0; bucket < LATENCY_BUCKETS - 1 && ns >= 2.0; bucket++)
+	    ns /= 2;
+	st->hist[bucket]++;
+    }
+    return NULL;
+}
+
+int replay_threads(backend_t *b, trace_t *trace, replay_stats_t *stats)
+{
+    replay_t r;
+    worker_t *workers;
+    pthread_t *tids;
+    int *last, *ops;
+    int i, t, n = trace->num_threads;
+    double start;
+
+    r.b = b;
+    r.trace = trace;
+    r.failed = 0;
+    r.wait_for = malloc(trace->num_ops * sizeof(int));
+    r.done = calloc(trace->num_ops, 1);
+    last = malloc(trace->num_ids * sizeof(int));
+    ops = malloc(trace->num_ops * sizeof(int));
+    workers = calloc(n, sizeof(worker_t));
+    tids = malloc(n * sizeof(pthread_t));
+    stats->num_threads = n;
+    stats->threads = calloc(n, sizeof(thread_stats_t));
+    if (!r.wait_for || !r.done || !last || !ops || !workers || !tids ||
+	!stats->threads) {
+	fprintf(stderr, "replay_threads: out of memory\n");
+	exit(1);
+    }
+
+    /* Find what each request waits for, and count each thread's */
+    for (i = 0; i < trace->num_ids; i++)
+	last[i] = -1;
+    for (i = 0; i < trace->num_ops; i++) {
+	traceop_t *op = &trace->ops[i];
+
+	r.wait_for[i] = -1;
+	if (last[op->index] >= 0 && trace->ops[last[op->index]].tid != op->tid)
+	    r.wait_for[i] = last[op->index];
+	last[op->index] = i;
+	workers[op->tid].num_ops++;
+    }
+
+    /* Lay the threads' request lists out next to each other in ops */
+    for (t = 0, i = 0; t < n; t++) {
+	workers[t].r = &r;
+	workers[t].ops = ops + i;
+	workers[t].stats = &stats->threads[t];
+	i += workers[t].num_ops;
+	workers[t].num_ops = 0;
+    }
+    for (i = 0; i < trace->num_ops; i++) {
+	worker_t *w = &workers[trace->ops[i].tid];
+	w->ops[w->num_ops++] = i;
+    }
+
+    /* Start from an empty heap, like the serial replay */
+    if (b->uses_memlib)
+	mem_reset_brk();
+    if (b->init() < 0) {
+	fprintf(stderr, "replay_threads: init failed\n");
+	exit(1);
+    }
+
+    pthread_mutex_init(&r.lock, NULL);
+    pthread_barrier_init(&r.start, NULL, n + 1);
+    for (t = 0; t < n; t++)
+	if (pthread_create(&tids[t], NULL, worker, &workers[t]) != 0) {
+	    fprintf(stderr, "replay_threads: pthread_create failed\n");
+	    exit(1);
+	}
+    pthread_barrier_wait(&r.start);
+    start = now_ns();
+    for (t = 0; t < n; t++)
+	pthread_join(tids[t], NULL);
+    stats->secs = (now_ns() - start) / 1e9;
+    pthread_barrier_destroy(&r.start);
+    pthread_mutex_destroy(&r.lock);
+
+    free(r.wait_for);
+    free(r.done);
+    free(last);
+    free(ops);
+    free(workers);
+    free(tids);
+    return r.failed ? -1 : 0;
+}
+
+double latency_quantile(thread_stats_t *t, double q)
+{
+    unsigned seen = 0;
+    int i;
+
+    for (i = 0; i < LATENCY_BUCKETS; i++) {
+	seen += t->hist[i];
+	if (seen >= q * t->ops) /* the upper end of the bucket */
+	    return MIN(2.0 * (1u << i) / 1e3, t->max_usecs);
+    }
+    return t->max_usecs;
+}
@@ -0,0 +1,48 @@
+/*
+ * replay.h - Multithreaded replay of a tracefile
+ *
+ * replay_threads runs the requests of each thread of a trace (see the
+ * "t <tid>" lines in trace.h) on a pthread of its own, all started at
+ * once. A request on a block made by one thread waits until the last
+ * request on that block made by another one has finished, so blocks are
+ * handed over between threads the way they were when the trace was
+ * recorded. Packages that aren't thread safe are called under one lock.
+ *
+ * The time of every call into the package is taken, which costs two
+ * clock reads per request; the time spent waiting for other threads is
+ * not part of it.
+ */
+#ifndef __REPLAY_H_
+#define __REPLAY_H_
+
+#include "backend.h"
+#include "trace.h"
+
+#define LATENCY_BUCKETS 32 /* bucket i: calls that took [2^i, 2^(i+1)) ns */
+
+/* What one thread of the replay saw */
+typedef struct {
+    int ops;                           /* requests it made */
+    double secs;                       /* time spent in the package */
+    double max_usecs;                  /* slowest call */
+    unsigned hist[LATENCY_BUCKETS];    /* latency histogram */
+} thread_stats_t;
+
+/* What the whole replay saw */
+typedef struct {
+    int num_threads;
+    double secs;               /* wall time from start to the last thread */
+    thread_stats_t *threads;   /* num_threads entries, freed by the caller */
+} replay_stats_t;
+
+/*
+ * Replay trace with one thread per trace thread; returns 0 on success,
+ * or -1 if the package failed a request
+ */
+int replay_threads(backend_t *b, trace_t *trace, replay_stats_t *stats);
+
+/* Latency (in usecs) below which fraction q of a thread's calls were,
+   rounded up to a power of two nanoseconds */
+double latency_quantile(thread_stats_t *t, double q);
+
+#endif /* __REPLAY_H_ */
@@ -0,0 +1,186 @@
+/*
+ * trace.c - Reading malloc lab tracefiles
+ *
+ * Shared by mdriver and the trace tools. See trace.h for the format.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "trace.h"
+
+#define MAXLINE     1024 /* max string size */
+
+extern int verbose; /* -V option of the program using the trace */
+
+/* 
+ * unix_error - Report a Unix-style error 
+ */
+static void unix_error(char *msg)
+{
+    printf("%s: %s\n", msg, strerror(errno));
+    exit(1);
+}
+
+/*
+ * open_trace - open a tracefile and read its header
+ */
+trace_reader_t *open_trace(char *tracedir, char *filename)
+{
+    trace_reader_t *reader;
+    char msg[2*MAXLINE];
+
+    if ((reader = (trace_reader_t *) malloc(sizeof(trace_reader_t))) == NULL)
+	unix_error("malloc failed in open_trace");
+    if ((reader->path = malloc(strlen(tracedir) + strlen(filename) + 1)) == NULL)
+	unix_error("malloc failed in open_trace");
+    strcpy(reader->path, tracedir);
+    strcat(reader->path, filename);
+
+    if ((reader->fp = fopen(reader->path, "r")) == NULL) {
+	sprintf(msg, "Could not open %s in read_trace", reader->path);
+	unix_error(msg);
+    }
+    if (fscanf(reader->fp, "%d", &reader->sugg_heapsize) != 1 ||
+	fscanf(reader->fp, "%d", &reader->num_ids) != 1 ||
+	fscanf(reader->fp, "%d", &reader->num_ops) != 1 ||
+	fscanf(reader->fp, "%d", &reader->weight) != 1) {
+	printf("Bad header in tracefile %s\n", reader->path);
+	exit(1);
+    }
+    reader->op_index = 0;
+    reader->tid = 0;
+    return reader;
+}
+
+/*
+ * next_op - read the next request into *op. Returns 1 if there was one
+ *     and 0 at the end of the file.
+ */
+int next_op(trace_reader_t *reader, traceop_t *op)
+{
+    char line[MAXLINE];
+    char *p, *end;
+    long tid;
+
+    while (fgets(line, MAXLINE, reader->fp) != NULL) {
+	for (p = line; *p == ' ' || *p == '\t'; p++)
+	    ;
+	if (*p == '\n' || *p == '\r' || *p == '\0')
+	    continue; /* blank line */
+	if (*p == 't') { /* the thread of the requests that follow */
+	    p += 1 + strspn(p + 1, " \t");
+	    tid = strtol(p, &end, 10);
+	    if (end == p || tid < 0 || tid >= TRACE_MAX_THREADS) {
+		printf("Bad thread id (%.*s) in tracefile %s\n",
+		       (int) strcspn(p, "\r\n"), p, reader->path);
+		exit(1);
+	    }
+	    reader->tid = (int) tid;
+	    continue;
+	}
+
+	switch (*p) {
+	case 'a':
+	    op->type = ALLOC;
+	    break;
+	case 'r':
+	    op->type = REALLOC;
+	    break;
+	case 'f':
+	    op->type = FREE;
+	    break;
+	default:
+	    printf("Bogus type character (%c) in tracefile %s\n", 
+		   *p, reader->path);
+	    exit(1);
+	}
+
+	op->index = (int) strtoul(p + 1, &end, 10);
+	op->size = (op->type == FREE) ? 0 : (int) strtoul(end, NULL, 10);
+	op->tid = reader->tid;
+	reader->op_index++;
+	return 1;
+    }
+    return 0;
+}
+
+/*
+ * close_trace - close a tracefile opened by open_trace
+ */
+void close_trace(trace_reader_t *reader)
+{
+    fclose(reader->fp);
+    free(reader->path);
+    free(reader);
+}
+
+/*
+ * read_trace - read a trace file and store it in memory
+ */
+trace_t *read_trace(char *tracedir, char *filename)
+{
+    trace_reader_t *reader;
+    trace_t *trace;
+    traceop_t op;
+    unsigned max_index = 0;
+
+    if (verbose > 1)
+	printf("Reading tracefile: %s\n", filename);
+
+    /* Allocate the trace record */
+    if ((trace = (trace_t *) malloc(sizeof(trace_t))) == NULL)
+	unix_error("malloc 1 failed in read_trance");
+	
+    /* Read the trace file header */
+    reader = open_trace(tracedir, filename);
+    trace->sugg_heapsize = reader->sugg_heapsize; /* not used */
+    trace->num_ids = reader->num_ids;
+    trace->num_ops = reader->num_ops;
+    trace->weight = reader->weight;               /* not used */
+    trace->num_threads = 1;
+    
+    /* We'll store each request line in the trace in this array */
+    if ((trace->ops = 
+	 (traceop_t *)malloc(trace->num_ops * sizeof(traceop_t))) == NULL)
+	unix_error("malloc 2 failed in read_trace");
+
+    /* We'll keep an array of pointers to the allocated blocks here... */
+    if ((trace->blocks = 
+	 (char **)malloc(trace->num_ids * sizeof(char *))) == NULL)
+	unix_error("malloc 3 failed in read_trace");
+
+    /* ... along with the corresponding byte sizes of each block */
+    if ((trace->block_sizes = 
+	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
+	unix_error("malloc 4 failed in read_trace");
+    
+    /* read every request line in the trace file */
+    while (next_op(reader, &op)) {
+	assert(reader->op_index <= trace->num_ops);
+	trace->ops[reader->op_index - 1] = op;
+	if (op.type != FREE)
+	    max_index = (op.index > max_index) ? op.index : max_index;
+	if (op.tid >= trace->num_threads)
+	    trace->num_threads = op.tid + 1;
+    }
+    assert(max_index == trace->num_ids - 1);
+    assert(trace->num_ops == reader->op_index);
+    close_trace(reader);
+    
+    return trace;
+}
+
+/*
+ * free_trace - Free the trace record and the three arrays it points
+ *              to, all of which were allocated in read_trace().
+ */
+void free_trace(trace_t *trace)
+{
+    free(trace->ops);         /* free the three arrays... */
+    free(trace->blocks);      
+    free(trace->block_sizes);
+    free(trace);              /* and the trace record itself... */
+}
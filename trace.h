@@ -0,0 +1,75 @@
+/*
+ * trace.h - Reading malloc lab tracefiles
+ *
+ * A tracefile starts with four header lines (suggested heap size, number
+ * of ids, number of ops, weight), followed by one request per line:
+ *
+ *   a <id> <size>    allocate size bytes and call the block id
+ *   r <id> <size>    reallocate block id to size bytes
+ *   f <id>           free block id
+ *
+ * Traces recorded from multithreaded programs (see mmrecord.c) may also
+ * have "t <tid>" lines, saying that the requests that follow were made by
+ * thread tid (numbered from 0; until the first such line, thread 0).
+ * Thread ids must be less than TRACE_MAX_THREADS.
+ * The order of the lines is an order in which the requests really
+ * happened. A multithreaded replay (see replay.h) runs each thread's
+ * requests in that order, and a request on a block waits for the last
+ * request on the same block if another thread made it, e.g. a free for
+ * the malloc that handed the block over. A serial replay just runs the
+ * lines in order.
+ *
+ * read_trace loads a whole trace into memory for replay. Tools that only
+ * need one pass over a trace (which may be too big to load) use the
+ * streaming interface instead: open_trace, next_op and close_trace.
+ */
+#ifndef __TRACE_H_
+#define __TRACE_H_
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define TRACE_MAX_THREADS 1024 /* bound on the ids of "t" lines */
+
+/* Characterizes a single trace operation (allocator request) */
+typedef struct {
+    enum {ALLOC, FREE, REALLOC} type; /* type of request */
+    int index;                        /* index for free() to use later */
+    int size;                         /* byte size of alloc/realloc request */
+    int tid;                          /* thread that made the request */
+} traceop_t;
+
+/* Holds the information for one trace file*/
+typedef struct {
+    int sugg_heapsize;   /* suggested heap size (unused) */
+    int num_ids;         /* number of alloc/realloc ids */
+    int num_ops;         /* number of distinct requests */
+    int weight;          /* weight for this trace (unused) */
+    int num_threads;     /* 1 + the largest thread id */
+    traceop_t *ops;      /* array of requests */
+    char **blocks;       /* array of ptrs returned by malloc/realloc... */
+    size_t *block_sizes; /* ... and a corresponding array of payload sizes */
+} trace_t;
+
+/* An open tracefile that is read one request at a time */
+typedef struct {
+    FILE *fp;
+    char *path;          /* for error messages */
+    int sugg_heapsize;   /* the four header fields */
+    int num_ids;
+    int num_ops;
+    int weight;
+    int op_index;        /* number of requests read so far */
+    int tid;             /* thread of the requests being read */
+} trace_reader_t;
+
+/* Load a whole tracefile, or free one loaded by read_trace */
+trace_t *read_trace(char *tracedir, char *filename);
+void free_trace(trace_t *trace);
+
+/* Read a tracefile one request at a time */
+trace_reader_t *open_trace(char *tracedir, char *filename);
+int next_op(trace_reader_t *reader, traceop_t *op); /* 0 at end of file */
+void close_trace(trace_reader_t *reader);
+
+#endif /* __TRACE_H_ */
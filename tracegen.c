@@ -0,0 +1,549 @@
+/*
+ * tracegen.c - Synthetic trace generator for the malloc lab driver
+ *
+ * Emits a .rep tracefile that mdriver can replay, built from one or more
+ * workload phases. Each phase runs for a given number of operations and
+ * draws its requests from one of three models:
+ *
+ *   random  Allocation sizes come from a size distribution and every
+ *           block gets a lifetime (in ops) from a lifetime distribution.
+ *           A block is freed once its lifetime has elapsed.
+ *   queue   Producer/consumer: blocks are appended to a FIFO queue and
+ *           freed from its head, so lifetimes follow the queue depth.
+ *   vector  Growing arrays: a set of vectors is repeatedly realloc'ed by
+ *           a growth factor until they reach a maximum size, at which
+ *           point they are freed and a new vector is started.
+ *
+ * Blocks outlive the phase that allocated them, so a phase change is
+ * seen by the allocator the same way it is in a real service: the old
+ * working set drains while the new one builds up. Whatever is still live
+ * at the end of the last phase is freed, so the trace is balanced.
+ *
+ * The same seed and phase list always produce the same trace. Ids and op
+ * counts are only limited by memory, so traces with millions of ops and
+ * ids are fine (mdriver's MAX_HEAP in config.h may need raising to
+ * replay them).
+ *
+ * Usage: tracegen [-s seed] [-o file] -p <phase> [-p <phase> ...]
+ *
+ * A phase is a comma-separated list of key=value pairs, e.g.
+ *
+ *   tracegen -s 7 -o web.rep \
+ *       -p ops=200000,size=pareto:16:1.3:65536,life=bimodal:20:20000:0.9 \
+ *       -p ops=50000,kind=queue,depth=2000,size=modes:64x3:1500x1 \
+ *       -p ops=50000,kind=vector,vectors=16,start=16,grow=1.5,max=1048576
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+/* Misc */
+#define MAXPHASES   64  /* max number of -p arguments */
+#define MAXMODES    16  /* max number of peaks in a modes: distribution */
+
+/*
+ * Size distributions
+ *   fixed:<n>                       every request is n bytes
+ *   uniform:<lo>:<hi>               uniform in [lo, hi]
+ *   pareto:<min>:<alpha>:<max>      power law, P(size > x) = (min/x)^alpha
+ *   modes:<size>x<weight>:...       mixture of peaks, each jittered by +-12%
+ */
+typedef struct {
+    enum {SIZE_FIXED, SIZE_UNIFORM, SIZE_PARETO, SIZE_MODES} type;
+    double a, b, c;                  /* parameters of fixed/uniform/pareto */
+    int nmodes;
+    double mode_size[MAXMODES];
+    double mode_cdf[MAXMODES];       /* cumulative, normalized weights */
+} sizedist_t;
+
+/*
+ * Lifetime distributions, in ops
+ *   exp:<mean>                      exponential
+ *   bimodal:<short>:<long>:<pshort> exponential with mean short with
+ *                                   probability pshort, otherwise long
+ */
+typedef struct {
+    enum {LIFE_EXP, LIFE_BIMODAL} type;
+    double mean_short, mean_long, p_short;
+} lifedist_t;
+
+/* One workload phase */
+typedef struct {
+    enum {KIND_RANDOM, KIND_QUEUE, KIND_VECTOR} kind;
+    long ops;           /* ops to emit in this phase */
+    sizedist_t size;    /* random and queue */
+    lifedist_t life;    /* random */
+    long depth;         /* queue: max number of queued blocks */
+    int vectors;        /* vector: number of concurrently growing vectors */
+    double start;       /* vector: initial size */
+    double grow;        /* vector: growth factor per realloc */
+    double max;         /* vector: size at which a vector is freed */
+} phase_t;
+
+/* A live block waiting to be freed */
+typedef struct {
+    long death;         /* op number at which it is freed */
+    long id;
+} event_t;
+
+/*
+ * Global state of the trace being generated
+ */
+static FILE *body;              /* the op lines, written before the header */
+static long num_ops = 0;        /* ops emitted so far */
+static long num_ids = 0;        /* ids handed out so far */
+static double live_bytes = 0;   /* current payload bytes */
+static double peak_bytes = 0;   /* high water mark of live_bytes */
+static double *id_size = NULL;  /* current payload size of each id */
+static long id_cap = 0;
+
+static event_t *heap = NULL;    /* min-heap of scheduled frees */
+static long heap_len = 0, heap_cap = 0;
+
+static unsigned long long rng_state;
+
+/* Function prototypes */
+static void parse_phase(char *spec, phase_t *p);
+static void run_phase(phase_t *p);
+static void usage(void);
+static void app_error(char *msg);
+
+
+/**********************************
+ * Random numbers (splitmix64)
+ **********************************/
+
+static unsigned long long rng_next(void)
+{
+    unsigned long long z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Uniform in (0, 1) */
+static double rng_unit(void)
+{
+    return ((rng_next() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+static double rng_exp(double mean)
+{
+    return -mean * log(rng_unit());
+}
+
+static long draw_size(sizedist_t *d)
+{
+    double u, x = 1;
+    int i;
+
+    switch (d->type) {
+    case SIZE_FIXED:
+        x = d->a;
+        break;
+    case SIZE_UNIFORM:
+        x = d->a + floor(rng_unit() * (d->b - d->a + 1));
+        break;
+    case SIZE_PARETO:
+        x = d->a / pow(rng_unit(), 1.0 / d->b);
+        if (x > d->c) x = d->c;
+        break;
+    case SIZE_MODES:
+        u = rng_unit();
+        for (i = 0; i < d->nmodes - 1 && u > d->mode_cdf[i]; i++)
+            ;
+        x = d->mode_size[i] * (0.88 + 0.24 * rng_unit());
+        break;
+    }
+    return (x < 1) ? 1 : (long)x;
+}
+
+static long draw_life(lifedist_t *d)
+{
+    double mean = d->mean_short;
+
+    if (d->type == LIFE_BIMODAL && rng_unit() >= d->p_short)
+        mean = d->mean_long;
+    return 1 + (long)rng_exp(mean);
+}
+
+
+/**********************************
+ * Emitting ops
+ **********************************/
+
+static long new_id(long size)
+{
+    if (num_ids == id_cap) {
+        id_cap = id_cap ? 2 * id_cap : 4096;
+        if ((id_size = realloc(id_size, id_cap * sizeof(double))) == NULL)
+            app_error("Out of memory for ids");
+    }
+    id_size[num_ids] = size;
+    return num_ids++;
+}
+
+static void track(double delta)
+{
+    live_bytes += delta;
+    if (live_bytes > peak_bytes)
+        peak_bytes = live_bytes;
+}
+
+static long emit_alloc(long size)
+{
+    long id = new_id(size);
+
+    fprintf(body, "a %ld %ld\n", id, size);
+    num_ops++;
+    track(size);
+    return id;
+}
+
+static void emit_realloc(long id, long size)
+{
+    fprintf(body, "r %ld %ld\n", id, size);
+    num_ops++;
+    track(size - id_size[id]);
+    id_size[id] = size;
+}
+
+static void emit_free(long id)
+{
+    fprintf(body, "f %ld\n", id);
+    num_ops++;
+    track(-id_size[id]);
+}
+
+
+/**********************************
+ * Scheduled frees (binary min-heap on death)
+ **********************************/
+
+static void schedule(long id, long death)
+{
+    long i, parent;
+    event_t e;
+
+    if (heap_len == heap_cap) {
+        heap_cap = heap_cap ? 2 * heap_cap : 4096;
+        if ((heap = realloc(heap, heap_cap * sizeof(event_t))) == NULL)
+            app_error("Out of memory for the free schedule");
+    }
+    e.death = death;
+    e.id = id;
+    for (i = heap_len++; i > 0; i = parent) {
+        parent = (i - 1) / 2;
+        if (heap[parent].death <= death)
+            break;
+        heap[i] = heap[parent];
+    }
+    heap[i] = e;
+}
+
+static event_t unschedule(void)
+{
+    event_t top = heap[0], last = heap[--heap_len];
+    long i = 0, child;
+
+    while ((child = 2 * i + 1) < heap_len) {
+        if (child + 1 < heap_len && heap[child + 1].death < heap[child].death)
+            child++;
+        if (last.death <= heap[child].death)
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+
+/**********************************
+ * Workload models
+ **********************************/
+
+static void run_random(phase_t *p, long end)
+{
+    long id;
+
+    while (num_ops < end) {
+        if (heap_len > 0 && heap[0].death <= num_ops) {
+            emit_free(unschedule().id);
+        } else {
+            id = emit_alloc(draw_size(&p->size));
+            schedule(id, num_ops + draw_life(&p->life));
+        }
+    }
+}
+
+static void run_queue(phase_t *p, long end)
+{
+    long *queue, head = 0, len = 0;
+
+    if ((queue = malloc(p->depth * sizeof(long))) == NULL)
+        app_error("Out of memory for the queue");
+
+    /* Producer and consumer take turns at random, bounded by the depth */
+    while (num_ops < end) {
+        if (len < p->depth && (len == 0 || rng_unit() < 0.5)) {
+            queue[(head + len) % p->depth] = emit_alloc(draw_size(&p->size));
+            len++;
+        } else {
+            emit_free(queue[head]);
+            head = (head + 1) % p->depth;
+            len--;
+        }
+    }
+
+    /* Hand whatever is still queued to the free schedule */
+    for (; len > 0; len--, head = (head + 1) % p->depth)
+        schedule(queue[head], num_ops + len);
+    free(queue);
+}
+
+static void run_vector(phase_t *p, long end)
+{
+    long *vec;
+    double next;
+    int i, nvec;
+
+    if ((vec = malloc(p->vectors * sizeof(long))) == NULL)
+        app_error("Out of memory for the vectors");
+    for (nvec = 0; nvec < p->vectors && num_ops < end; nvec++)
+        vec[nvec] = emit_alloc((long)p->start);
+
+    /* Grow a random vector, or retire it once it would exceed max */
+    while (num_ops < end) {
+        i = rng_next() % nvec;
+        next = ceil(id_size[vec[i]] * p->grow);
+        if (next <= p->max) {
+            emit_realloc(vec[i], (long)next);
+        } else {
+            emit_free(vec[i]);
+            vec[i] = emit_alloc((long)p->start);
+        }
+    }
+
+    for (i = 0; i < nvec; i++)
+        schedule(vec[i], num_ops + i + 1);
+    free(vec);
+}
+
+static void run_phase(phase_t *p)
+{
+    long end = num_ops + p->ops;
+
+    switch (p->kind) {
+    case KIND_RANDOM:
+        run_random(p, end);
+        break;
+    case KIND_QUEUE:
+        run_queue(p, end);
+        break;
+    case KIND_VECTOR:
+        run_vector(p, end);
+        break;
+    }
+}
+
+
+/**********************************
+ * Parsing phase specs
+ **********************************/
+
+static void parse_size(char *arg, sizedist_t *d)
+{
+    char *tok;
+    double total = 0;
+    int i;
+
+    if (sscanf(arg, "fixed:%lf", &d->a) == 1) {
+        d->type = SIZE_FIXED;
+    } else if (sscanf(arg, "uniform:%lf:%lf", &d->a, &d->b) == 2) {
+        d->type = SIZE_UNIFORM;
+    } else if (sscanf(arg, "pareto:%lf:%lf:%lf", &d->a, &d->b, &d->c) == 3) {
+        d->type = SIZE_PARETO;
+    } else if (!strncmp(arg, "modes:", 6)) {
+        d->type = SIZE_MODES;
+        d->nmodes = 0;
+        for (tok = strtok(arg + 6, ":"); tok; tok = strtok(NULL, ":")) {
+            if (d->nmodes == MAXMODES)
+                app_error("Too many modes in size distribution");
+            if (sscanf(tok, "%lfx%lf", &d->mode_size[d->nmodes],
+                       &d->mode_cdf[d->nmodes]) != 2)
+                app_error("Bad mode, expected <size>x<weight>");
+            total += d->mode_cdf[d->nmodes++];
+        }
+        if (d->nmodes == 0 || total <= 0)
+            app_error("Empty modes distribution");
+        for (i = 0; i < d->nmodes; i++)
+            d->mode_cdf[i] = (i ? d->mode_cdf[i-1] : 0) + d->mode_cdf[i] / total;
+    } else {
+        fprintf(stderr, "Bad size distribution: %s\n", arg);
+        exit(1);
+    }
+}
+
+static void parse_life(char *arg, lifedist_t *d)
+{
+    if (sscanf(arg, "exp:%lf", &d->mean_short) == 1) {
+        d->type = LIFE_EXP;
+    } else if (sscanf(arg, "bimodal:%lf:%lf:%lf", &d->mean_short,
+                      &d->mean_long, &d->p_short) == 3) {
+        d->type = LIFE_BIMODAL;
+    } else {
+        fprintf(stderr, "Bad lifetime distribution: %s\n", arg);
+        exit(1);
+    }
+}
+
+static void parse_phase(char *spec, phase_t *p)
+{
+    char *kv, *val, *save;
+
+    /* Defaults */
+    memset(p, 0, sizeof(phase_t));
+    p->kind = KIND_RANDOM;
+    p->ops = 10000;
+    p->size.type = SIZE_UNIFORM;
+    p->size.a = 8;
+    p->size.b = 512;
+    p->life.type = LIFE_EXP;
+    p->life.mean_short = 100;
+    p->depth = 1000;
+    p->vectors = 8;
+    p->start = 16;
+    p->grow = 2.0;
+    p->max = 65536;
+
+    for (kv = strtok_r(spec, ",", &save); kv; kv = strtok_r(NULL, ",", &save)) {
+        if ((val = strchr(kv, '=')) == NULL) {
+            fprintf(stderr, "Bad phase setting (expected key=value): %s\n", kv);
+            exit(1);
+        }
+        *val++ = '\0';
+        if (!strcmp(kv, "kind")) {
+            if (!strcmp(val, "random")) p->kind = KIND_RANDOM;
+            else if (!strcmp(val, "queue")) p->kind = KIND_QUEUE;
+            else if (!strcmp(val, "vector")) p->kind = KIND_VECTOR;
+            else app_error("kind must be random, queue or vector");
+        }
+        else if (!strcmp(kv, "ops")) p->ops = atol(val);
+        else if (!strcmp(kv, "size")) parse_size(val, &p->size);
+        else if (!strcmp(kv, "life")) parse_life(val, &p->life);
+        else if (!strcmp(kv, "depth")) p->depth = atol(val);
+        else if (!strcmp(kv, "vectors")) p->vectors = atoi(val);
+        else if (!strcmp(kv, "start")) p->start = atof(val);
+        else if (!strcmp(kv, "grow")) p->grow = atof(val);
+        else if (!strcmp(kv, "max")) p->max = atof(val);
+        else {
+            fprintf(stderr, "Unknown phase setting: %s\n", kv);
+            exit(1);
+        }
+    }
+
+    if (p->depth < 1 || p->vectors < 1 || p->start < 1 || p->grow <= 1.0)
+        app_error("depth, vectors and start must be >= 1 and grow > 1");
+}
+
+
+/**************
+ * Main routine
+ **************/
+int main(int argc, char **argv)
+{
+    int c, i, nphases = 0;
+    unsigned long long seed = 1;
+    char *outfile = NULL;
+    phase_t phases[MAXPHASES];
+    FILE *out = stdout;
+    char buf[BUFSIZ];
+    size_t n;
+
+    while ((c = getopt(argc, argv, "s:o:p:h")) != EOF) {
+        switch (c) {
+        case 's': /* Random seed */
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'o': /* Output file (default stdout) */
+            outfile = optarg;
+            break;
+        case 'p': /* Add a phase */
+            if (nphases == MAXPHASES)
+                app_error("Too many phases");
+            parse_phase(optarg, &phases[nphases++]);
+            break;
+        case 'h':
+            usage();
+            exit(0);
+        default:
+            usage();
+            exit(1);
+        }
+    }
+    if (nphases == 0) {
+        usage();
+        exit(1);
+    }
+    rng_state = seed;
+
+    /* The header needs the totals, so write the ops to a scratch file first */
+    if ((body = tmpfile()) == NULL)
+        app_error("Could not create a temporary file");
+
+    for (i = 0; i < nphases; i++)
+        run_phase(&phases[i]);
+
+    /* Drain the schedule so that every block is freed */
+    while (heap_len > 0)
+        emit_free(unschedule().id);
+
+    if (outfile && (out = fopen(outfile, "w")) == NULL) {
+        fprintf(stderr, "Could not open %s\n", outfile);
+        exit(1);
+    }
+    fprintf(out, "%.0f\n%ld\n%ld\n%d\n", peak_bytes, num_ids, num_ops, 1);
+    rewind(body);
+    while ((n = fread(buf, 1, sizeof(buf), body)) > 0)
+        fwrite(buf, 1, n, out);
+    fclose(body);
+    if (out != stdout)
+        fclose(out);
+
+    fprintf(stderr, "%ld ops, %ld ids, peak live payload %.0f bytes\n",
+            num_ops, num_ids, peak_bytes);
+    free(id_size);
+    free(heap);
+    exit(0);
+}
+
+/*
+ * app_error - Report an arbitrary application error
+ */
+static void app_error(char *msg)
+{
+    fprintf(stderr, "%s\n", msg);
+    exit(1);
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: tracegen [-h] [-s <seed>] [-o <file>] -p <phase> [-p <phase> ...]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h          Print this message.\n");
+    fprintf(stderr, "\t-o <file>   Write the trace to <file> instead of stdout.\n");
+    fprintf(stderr, "\t-p <phase>  Append a phase, a list of key=value settings:\n");
+    fprintf(stderr, "\t              kind=random|queue|vector  ops=<n>\n");
+    fprintf(stderr, "\t              size=fixed:<n> | uniform:<lo>:<hi> |\n");
+    fprintf(stderr, "\t                   pareto:<min>:<alpha>:<max> | modes:<size>x<weight>:...\n");
+    fprintf(stderr, "\t              life=exp:<mean> | bimodal:<short>:<long>:<pshort>  (random)\n");
+    fprintf(stderr, "\t              depth=<n>  (queue)\n");
+    fprintf(stderr, "\t              vectors=<n> start=<bytes> grow=<factor> max=<bytes>  (vector)\n");
+    fprintf(stderr, "\t-s <seed>   Random seed (default 1).\n");
+}
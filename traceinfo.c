@@ -0,0 +1,491 @@
+/*
+ * traceinfo.c - Characterize what a malloc lab trace actually does
+ *
+ * Reads each tracefile in a single streaming pass (with the reader in
+ * trace.c, so even traces too big to load are fine) and reports:
+ *
+ *   - the request size histogram (power-of-two buckets)
+ *   - the lifetime of blocks, in ops from allocation to free
+ *   - the live payload bytes over the course of the trace, as the peak
+ *     within each of a fixed number of windows
+ *   - realloc chain lengths (reallocs per block) and growth factors
+ *   - the working set of distinct request sizes, overall and per window
+ *
+ * Memory use is a few words per id plus one entry per distinct size,
+ * independent of the number of ops.
+ *
+ * Usage: traceinfo [-j] [-w windows] [-t dir] file...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+/* Misc */
+#define NBUCKETS     33  /* power-of-two histogram buckets (0..2^32) */
+#define NGROWTH       8  /* realloc growth factor buckets */
+#define WINDOWS     100  /* default number of windows for the curves */
+#define TOPSIZES     10  /* most frequent sizes to list */
+
+int verbose = 0; /* used by trace.c */
+
+/* Upper bounds of the realloc growth factor (new size / old size) buckets */
+static double growth_bounds[NGROWTH] = {0.5, 1.0, 1.25, 1.5, 2.0, 4.0, 8.0, 1e300};
+static char *growth_names[NGROWTH] =
+    {"<0.5", "0.5-1", "1-1.25", "1.25-1.5", "1.5-2", "2-4", "4-8", ">=8"};
+
+/* One entry per distinct request size */
+typedef struct {
+    int used;            /* 0 marks an empty slot */
+    int size;
+    int last_window;     /* last window the size was requested in */
+    long count;          /* number of allocs and reallocs of this size */
+} sizeent_t;
+
+/* Everything that is reported for one trace */
+typedef struct {
+    long ops, allocs, reallocs, frees;
+    long bad_frees;                 /* frees of ids that weren't live */
+    double alloc_bytes;
+
+    long size_hist[NBUCKETS];       /* requests by size */
+    long life_hist[NBUCKETS];       /* freed blocks by lifetime in ops */
+    long never_freed;
+    double life_sum;
+
+    long chain_hist[NBUCKETS];      /* freed blocks by number of reallocs */
+    long longest_chain;
+    long growth_hist[NGROWTH];
+
+    double live, peak;              /* live payload bytes */
+    long peak_op;
+    int nwindows;
+    long window_ops;                /* ops per window */
+    double *window_peak;            /* peak live bytes in each window */
+    long *window_sizes;             /* distinct sizes requested in each window */
+
+    sizeent_t *sizes;               /* open-addressed set of distinct sizes */
+    long sizes_cap, sizes_len;
+} info_t;
+
+/* Per-id state while streaming */
+static int *birth = NULL;   /* op of the alloc */
+static int *cur_size = NULL;
+static int *chain = NULL;   /* reallocs so far */
+
+/* Function prototypes */
+static void analyze(char *tracedir, char *filename, int nwindows, int json,
+                    int first);
+static void usage(void);
+
+
+/**********************************
+ * Helpers
+ **********************************/
+
+/* Power-of-two bucket: 0 for 0, otherwise 1 + floor(log2(x)) */
+static int bucket(unsigned long x)
+{
+    int b = 0;
+
+    while (x) {
+        b++;
+        x >>= 1;
+    }
+    return (b < NBUCKETS) ? b : NBUCKETS - 1;
+}
+
+/* Smallest value in a bucket */
+static unsigned long bucket_lo(int b)
+{
+    return b ? 1UL << (b - 1) : 0;
+}
+
+static void *xcalloc(size_t n, size_t size)
+{
+    void *p = calloc(n ? n : 1, size);
+
+    if (!p) {
+        fprintf(stderr, "traceinfo: out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+/* Find or insert size in the distinct size set */
+static sizeent_t *lookup_size(info_t *info, int size)
+{
+    sizeent_t *old;
+    long i, oldcap;
+    unsigned long h;
+
+    /* Keep the table at most half full */
+    if (2 * (info->sizes_len + 1) > info->sizes_cap) {
+        old = info->sizes;
+        oldcap = info->sizes_cap;
+        info->sizes_cap = oldcap ? 2 * oldcap : 1024;
+        info->sizes = xcalloc(info->sizes_cap, sizeof(sizeent_t));
+        info->sizes_len = 0;
+        for (i = 0; i < oldcap; i++) {
+            if (old[i].used)
+                *lookup_size(info, old[i].size) = old[i];
+        }
+        free(old);
+    }
+
+    h = ((unsigned long) size * 0x9E3779B1UL) & (info->sizes_cap - 1);
+    while (info->sizes[h].used && info->sizes[h].size != size)
+        h = (h + 1) & (info->sizes_cap - 1);
+    if (!info->sizes[h].used) {
+        info->sizes[h].used = 1;
+        info->sizes[h].size = size;
+        info->sizes[h].last_window = -1;
+        info->sizes_len++;
+    }
+    return &info->sizes[h];
+}
+
+static void note_size(info_t *info, int size, int window)
+{
+    sizeent_t *e = lookup_size(info, size);
+
+    e->count++;
+    if (e->last_window != window) {
+        e->last_window = window;
+        info->window_sizes[window]++;
+    }
+    info->size_hist[bucket(size)]++;
+}
+
+static void note_live(info_t *info, double delta, long op, int window)
+{
+    info->live += delta;
+    if (info->live > info->peak) {
+        info->peak = info->live;
+        info->peak_op = op;
+    }
+    if (info->live > info->window_peak[window])
+        info->window_peak[window] = info->live;
+}
+
+static int cmp_count(const void *a, const void *b)
+{
+    long ca = ((sizeent_t *)a)->count, cb = ((sizeent_t *)b)->count;
+
+    return (ca < cb) - (ca > cb);
+}
+
+
+/**********************************
+ * Output
+ **********************************/
+
+static void print_hist_text(char *title, char *unit, long *hist, int n)
+{
+    int b;
+
+    printf("%s\n", title);
+    for (b = 0; b < n; b++) {
+        if (hist[b])
+            printf("  %10lu - %-10lu %s %12ld\n", bucket_lo(b),
+                   b ? (bucket_lo(b) << 1) - 1 : 0, unit, hist[b]);
+    }
+}
+
+/* Print s as a JSON string, escaping quotes, backslashes and controls */
+static void print_json_string(char *s)
+{
+    unsigned char c;
+
+    putchar('"');
+    for (; (c = *s) != '\0'; s++) {
+        if (c == '"' || c == '\\')
+            printf("\\%c", c);
+        else if (c < 0x20)
+            printf("\\u%04x", c);
+        else
+            putchar(c);
+    }
+    putchar('"');
+}
+
+static void print_hist_json(char *name, long *hist, int n, int more)
+{
+    int b, first = 1;
+
+    printf("    \"%s\": [", name);
+    for (b = 0; b < n; b++) {
+        if (hist[b]) {
+            printf("%s{\"lo\": %lu, \"count\": %ld}", first ? "" : ", ",
+                   bucket_lo(b), hist[b]);
+            first = 0;
+        }
+    }
+    printf("]%s\n", more ? "," : "");
+}
+
+static void print_text(char *filename, info_t *info, sizeent_t *top, int ntop)
+{
+    int i;
+
+    printf("Trace %s\n", filename);
+    printf("  %ld ops: %ld allocs, %ld reallocs, %ld frees\n", info->ops,
+           info->allocs, info->reallocs, info->frees);
+    if (info->bad_frees)
+        printf("  %ld frees of ids that weren't live (ignored)\n",
+               info->bad_frees);
+    printf("  %.0f bytes requested by allocs, mean %.1f bytes\n",
+           info->alloc_bytes, info->allocs ? info->alloc_bytes / info->allocs : 0);
+    printf("  peak live payload %.0f bytes at op %ld\n", info->peak, info->peak_op);
+    printf("  %ld distinct request sizes\n\n", info->sizes_len);
+
+    print_hist_text("Request sizes (allocs and reallocs)", "bytes",
+                    info->size_hist, NBUCKETS);
+    printf("  most frequent:");
+    for (i = 0; i < ntop; i++)
+        printf(" %d (%ld)", top[i].size, top[i].count);
+    printf("\n\n");
+
+    print_hist_text("Lifetimes of freed blocks", "ops  ", info->life_hist, NBUCKETS);
+    printf("  mean %.1f ops, %ld blocks never freed\n\n",
+           info->frees ? info->life_sum / info->frees : 0, info->never_freed);
+
+    print_hist_text("Realloc chain length of freed blocks", "     ",
+                    info->chain_hist, NBUCKETS);
+    printf("  longest chain %ld\n", info->longest_chain);
+    printf("Realloc growth factors\n");
+    for (i = 0; i < NGROWTH; i++)
+        if (info->growth_hist[i])
+            printf("  %10s %12ld\n", growth_names[i], info->growth_hist[i]);
+
+    printf("\nLive payload and distinct sizes per window of %ld ops\n",
+           info->window_ops);
+    printf("  %6s %12s %14s %8s\n", "window", "first op", "peak bytes", "sizes");
+    for (i = 0; i < info->nwindows; i++)
+        printf("  %6d %12ld %14.0f %8ld\n", i, i * info->window_ops,
+               info->window_peak[i], info->window_sizes[i]);
+}
+
+static void print_json(char *filename, info_t *info, sizeent_t *top, int ntop,
+                       int first)
+{
+    int i;
+
+    printf("%s  {\n", first ? "" : ",\n");
+    printf("    \"trace\": ");
+    print_json_string(filename);
+    printf(",\n");
+    printf("    \"ops\": %ld, \"allocs\": %ld, \"reallocs\": %ld, \"frees\": %ld,"
+           " \"bad_frees\": %ld,\n",
+           info->ops, info->allocs, info->reallocs, info->frees, info->bad_frees);
+    printf("    \"alloc_bytes\": %.0f, \"peak_live_bytes\": %.0f, \"peak_op\": %ld,\n",
+           info->alloc_bytes, info->peak, info->peak_op);
+    printf("    \"distinct_sizes\": %ld, \"never_freed\": %ld, \"longest_chain\": %ld,\n",
+           info->sizes_len, info->never_freed, info->longest_chain);
+    printf("    \"top_sizes\": [");
+    for (i = 0; i < ntop; i++)
+        printf("%s{\"size\": %d, \"count\": %ld}", i ? ", " : "",
+               top[i].size, top[i].count);
+    printf("],\n");
+    print_hist_json("size_hist", info->size_hist, NBUCKETS, 1);
+    print_hist_json("lifetime_hist", info->life_hist, NBUCKETS, 1);
+    print_hist_json("chain_hist", info->chain_hist, NBUCKETS, 1);
+    printf("    \"growth_hist\": [");
+    for (i = 0; i < NGROWTH; i++)
+        printf("%s{\"range\": \"%s\", \"count\": %ld}", i ? ", " : "",
+               growth_names[i], info->growth_hist[i]);
+    printf("],\n");
+    printf("    \"window_ops\": %ld,\n    \"window_peak_bytes\": [", info->window_ops);
+    for (i = 0; i < info->nwindows; i++)
+        printf("%s%.0f", i ? ", " : "", info->window_peak[i]);
+    printf("],\n    \"window_distinct_sizes\": [");
+    for (i = 0; i < info->nwindows; i++)
+        printf("%s%ld", i ? ", " : "", info->window_sizes[i]);
+    printf("]\n  }");
+}
+
+
+/**********************************
+ * The streaming pass
+ **********************************/
+
+static void analyze(char *tracedir, char *filename, int nwindows, int json,
+                    int first)
+{
+    trace_reader_t *reader;
+    traceop_t op;
+    info_t info;
+    sizeent_t *top;
+    long i, n, life, num_ids;
+    int window, g;
+    double factor;
+
+    reader = open_trace(tracedir, filename);
+    memset(&info, 0, sizeof(info));
+    info.nwindows = (reader->num_ops < nwindows) ?
+        (reader->num_ops ? reader->num_ops : 1) : nwindows;
+    info.window_ops = (reader->num_ops + info.nwindows - 1) / info.nwindows;
+    if (info.window_ops == 0)
+        info.window_ops = 1;
+    info.nwindows = (reader->num_ops + info.window_ops - 1) / info.window_ops;
+    if (info.nwindows == 0)
+        info.nwindows = 1;
+    info.window_peak = xcalloc(info.nwindows, sizeof(double));
+    info.window_sizes = xcalloc(info.nwindows, sizeof(long));
+
+    num_ids = reader->num_ids;
+    birth = xcalloc(num_ids, sizeof(int));
+    cur_size = xcalloc(num_ids, sizeof(int));
+    chain = xcalloc(num_ids, sizeof(int));
+    for (i = 0; i < num_ids; i++)
+        birth[i] = -1;
+
+    while (next_op(reader, &op)) {
+        n = info.ops++;
+        window = n / info.window_ops;
+        if (window >= info.nwindows)
+            window = info.nwindows - 1;
+        if (op.index < 0 || op.index >= num_ids) {
+            fprintf(stderr, "%s: id %d out of range at op %ld\n",
+                    filename, op.index, n);
+            exit(1);
+        }
+
+        switch (op.type) {
+        case ALLOC:
+            info.allocs++;
+            info.alloc_bytes += op.size;
+            birth[op.index] = n;
+            cur_size[op.index] = op.size;
+            chain[op.index] = 0;
+            note_size(&info, op.size, window);
+            note_live(&info, op.size, n, window);
+            break;
+
+        case REALLOC:
+            info.reallocs++;
+            if (birth[op.index] < 0) { /* realloc(NULL, size) */
+                birth[op.index] = n;
+                cur_size[op.index] = 0;
+            }
+            if (cur_size[op.index] > 0) {
+                factor = (double) op.size / cur_size[op.index];
+                for (g = 0; factor >= growth_bounds[g]; g++)
+                    ;
+                info.growth_hist[g]++;
+            }
+            chain[op.index]++;
+            note_size(&info, op.size, window);
+            note_live(&info, op.size - cur_size[op.index], n, window);
+            cur_size[op.index] = op.size;
+            break;
+
+        case FREE:
+            if (birth[op.index] < 0) { /* double free, or never allocated */
+                info.bad_frees++;
+                break;
+            }
+            info.frees++;
+            life = n - birth[op.index];
+            info.life_hist[bucket(life)]++;
+            info.life_sum += life;
+            info.chain_hist[bucket(chain[op.index])]++;
+            if (chain[op.index] > info.longest_chain)
+                info.longest_chain = chain[op.index];
+            note_live(&info, -cur_size[op.index], n, window);
+            birth[op.index] = -1;
+            break;
+        }
+    }
+    close_trace(reader);
+
+    /* Blocks still live at the end of the trace */
+    for (i = 0; i < num_ids; i++)
+        if (birth[i] >= 0)
+            info.never_freed++;
+
+    /* Most frequent sizes: compact the set and sort it by count */
+    top = xcalloc(info.sizes_len, sizeof(sizeent_t));
+    for (i = 0, n = 0; i < info.sizes_cap; i++)
+        if (info.sizes[i].used)
+            top[n++] = info.sizes[i];
+    qsort(top, n, sizeof(sizeent_t), cmp_count);
+    n = (n < TOPSIZES) ? n : TOPSIZES;
+
+    if (json)
+        print_json(filename, &info, top, n, first);
+    else
+        print_text(filename, &info, top, n);
+
+    free(top);
+    free(info.sizes);
+    free(info.window_peak);
+    free(info.window_sizes);
+    free(birth);
+    free(cur_size);
+    free(chain);
+}
+
+
+/**************
+ * Main routine
+ **************/
+int main(int argc, char **argv)
+{
+    int c, i;
+    int json = 0;
+    int nwindows = WINDOWS;
+    char *tracedir = "";
+
+    while ((c = getopt(argc, argv, "jw:t:h")) != EOF) {
+        switch (c) {
+        case 'j': /* JSON output */
+            json = 1;
+            break;
+        case 'w': /* Number of windows for the curves */
+            nwindows = atoi(optarg);
+            if (nwindows < 1)
+                nwindows = 1;
+            break;
+        case 't': /* Directory the tracefiles are in */
+            tracedir = optarg;
+            break;
+        case 'h':
+            usage();
+            exit(0);
+        default:
+            usage();
+            exit(1);
+        }
+    }
+    if (optind == argc) {
+        usage();
+        exit(1);
+    }
+
+    if (json)
+        printf("[\n");
+    for (i = optind; i < argc; i++) {
+        if (!json && i > optind)
+            printf("\n");
+        analyze(tracedir, argv[i], nwindows, json, i == optind);
+    }
+    if (json)
+        printf("\n]\n");
+    exit(0);
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: traceinfo [-hj] [-w <windows>] [-t <dir>] <file>...\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h          Print this message.\n");
+    fprintf(stderr, "\t-j          Print JSON instead of text.\n");
+    fprintf(stderr, "\t-t <dir>    Directory the tracefiles are in (default: as given).\n");
+    fprintf(stderr, "\t-w <n>      Number of windows for the curves (default %d).\n", WINDOWS);
+}